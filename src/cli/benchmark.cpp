@@ -0,0 +1,445 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/error.hpp>
+#include <util/version.hpp>
+#include <util/io/package_manager.hpp>
+#include <util/io/reader.hpp>
+#include <util/small_object_pool.hpp>
+#include <script/context.hpp>
+#include <script/parser.hpp>
+#include <script/functions/functions.hpp>
+#include <cli/benchmark.hpp>
+#include <cli/text_io_handler.hpp>
+#include <data/game.hpp>
+#include <data/stylesheet.hpp>
+#include <data/set.hpp>
+#include <data/card.hpp>
+#include <data/symbol.hpp>
+#include <data/field/text.hpp>
+#include <data/field/color.hpp>
+#include <data/format/formats.hpp>
+#include <data/format/image_to_symbol.hpp>
+#include <render/card/viewer.hpp>
+#include <render/value/text.hpp>
+#include <render/symbol/filter.hpp>
+#include <wx/filename.h>
+#include <wx/wfstream.h>
+#include <wx/txtstrm.h>
+#include <chrono>
+
+// ----------------------------------------------------------------------------- : Options
+
+/// Options for the benchmark, see the --help text in main.cpp
+struct BenchmarkOptions {
+  String data_dir;                       ///< Directory containing the benchmark packages, used as local data dir
+  String game       = _("benchmark");    ///< Game to load
+  String stylesheet = _("standard");     ///< Stylesheet to load
+  String symbol;                         ///< Symbol file to render
+  String golden_dir;                     ///< Directory with golden images
+  String output;                         ///< File to write results to, or empty for stdout
+  int    cards        = 100;             ///< Number of cards in the generated set
+  int    iterations   = 5;               ///< Number of times to repeat the whole-set stages
+  int    golden_cards = 5;               ///< Number of cards to compare against golden images
+  int    tolerance    = 8;               ///< Maximum difference of a color channel before a pixel counts as different
+  int    import_size  = 800;             ///< Size of the generated image to trace as a symbol, 0 to skip
+  bool   update_golden = false;          ///< Write golden images instead of comparing against them
+  bool   require_golden = false;         ///< Fail when golden images are missing
+};
+
+static const String& next_arg(const vector<String>& args, size_t& i) {
+  if (i + 1 >= args.size()) {
+    throw Error(_("Missing value for --benchmark option ") + args[i]);
+  }
+  return args[++i];
+}
+static int next_int_arg(const vector<String>& args, size_t& i) {
+  long value;
+  const String& arg = next_arg(args, i);
+  if (!arg.ToLong(&value) || value < 0) {
+    throw Error(_("Expected a number for --benchmark option ") + args[i-1] + _(", not: ") + arg);
+  }
+  return (int)value;
+}
+
+static void parse_options(const vector<String>& args, BenchmarkOptions& opt) {
+  for (size_t i = 0 ; i < args.size() ; ++i) {
+    const String& arg = args[i];
+    if      (arg == _("--data"))          opt.data_dir      = next_arg(args, i);
+    else if (arg == _("--game"))          opt.game          = next_arg(args, i);
+    else if (arg == _("--stylesheet"))    opt.stylesheet    = next_arg(args, i);
+    else if (arg == _("--symbol"))        opt.symbol        = next_arg(args, i);
+    else if (arg == _("--golden"))        opt.golden_dir    = next_arg(args, i);
+    else if (arg == _("--output"))        opt.output        = next_arg(args, i);
+    else if (arg == _("--cards"))         opt.cards         = next_int_arg(args, i);
+    else if (arg == _("--iterations"))    opt.iterations    = max(1, next_int_arg(args, i));
+    else if (arg == _("--golden-cards"))  opt.golden_cards  = next_int_arg(args, i);
+    else if (arg == _("--tolerance"))     opt.tolerance     = next_int_arg(args, i);
+    else if (arg == _("--import-size"))   opt.import_size   = next_int_arg(args, i);
+    else if (arg == _("--update-golden")) opt.update_golden = true;
+    else if (arg == _("--require-golden")) opt.require_golden = true;
+    else throw Error(_("Unknown --benchmark option: ") + arg);
+  }
+  // defaults relative to the data directory
+  if (!opt.data_dir.empty()) {
+    if (opt.symbol.empty())     opt.symbol     = opt.data_dir + _("/benchmark.mse-symbol");
+    if (opt.golden_dir.empty()) opt.golden_dir = opt.data_dir + _("/../golden");
+  }
+}
+
+// ----------------------------------------------------------------------------- : Timings
+
+/// Timings of a single stage of the benchmark, in milliseconds
+class StageTimings {
+public:
+  StageTimings(const String& name) : name(name) {}
+
+  /// Time a single run of f
+  template <typename F> void time(F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  /// Summary of the samples as a JSON object
+  String toJSON() {
+    if (samples.empty()) return _("{\"count\":0}");
+    sort(samples.begin(), samples.end());
+    double total = 0;
+    FOR_EACH(s, samples) total += s;
+    return String::Format(_("{\"count\":%d,\"total_ms\":%.3f,\"mean_ms\":%.3f,\"min_ms\":%.3f,\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}"),
+      (int)samples.size(), total, total / samples.size(), samples.front(),
+      percentile(50), percentile(90), percentile(99), samples.back());
+  }
+
+  String name;
+private:
+  vector<double> samples;
+
+  /// Nearest rank percentile, samples must be sorted
+  double percentile(int p) const {
+    size_t rank = (p * samples.size() + 99) / 100;
+    return samples[rank > 0 ? rank - 1 : 0];
+  }
+};
+
+// ----------------------------------------------------------------------------- : Golden images
+
+/// Result of comparing rendered images against golden images
+struct GoldenResults {
+  int compared = 0, missing = 0, written = 0;
+  vector<String> failures; ///< Descriptions of the images that differ
+};
+
+/// Compare an image against the golden image with the given name, or write it if opt.update_golden
+static void check_golden(const BenchmarkOptions& opt, const String& name, Image img, GoldenResults& results) {
+  if (opt.golden_dir.empty()) return;
+  String filename = opt.golden_dir + _("/") + name;
+  if (opt.update_golden) {
+    if (!wxDirExists(opt.golden_dir)) wxMkdir(opt.golden_dir);
+    if (!img.SaveFile(filename, wxBITMAP_TYPE_PNG)) {
+      throw Error(_("Unable to write golden image: ") + filename);
+    }
+    results.written++;
+    return;
+  }
+  if (!wxFileExists(filename)) {
+    results.missing++;
+    return;
+  }
+  Image golden(filename, wxBITMAP_TYPE_PNG);
+  results.compared++;
+  if (!golden.Ok() || golden.GetWidth() != img.GetWidth() || golden.GetHeight() != img.GetHeight()) {
+    results.failures.push_back(name + _(": size differs"));
+    return;
+  }
+  // count pixels that differ by more than the tolerance in any channel
+  const Byte* a = img.GetData();
+  const Byte* b = golden.GetData();
+  const Byte* a_alpha = img.HasAlpha()    ? img.GetAlpha()    : nullptr;
+  const Byte* b_alpha = golden.HasAlpha() ? golden.GetAlpha() : nullptr;
+  int pixels = img.GetWidth() * img.GetHeight();
+  int different = 0, max_diff = 0;
+  for (int i = 0 ; i < pixels ; ++i) {
+    int diff = max(abs(a[3*i] - b[3*i]), max(abs(a[3*i+1] - b[3*i+1]), abs(a[3*i+2] - b[3*i+2])));
+    if (a_alpha || b_alpha) {
+      diff = max(diff, abs((a_alpha ? a_alpha[i] : 255) - (b_alpha ? b_alpha[i] : 255)));
+    }
+    max_diff = max(max_diff, diff);
+    if (diff > opt.tolerance) different++;
+  }
+  if (different > 0) {
+    results.failures.push_back(String::Format(_("%s: %d pixels differ, maximum difference %d"), name, different, max_diff));
+  }
+}
+
+// ----------------------------------------------------------------------------- : Benchmark set
+
+/// Text fragments used to generate card text of varying length
+static const Char* rule_text_fragments[] = {
+  _("<b>Flying</b>"),
+  _("When this card enters the battlefield, draw a card."),
+  _("<i>The benchmark is the measure of all things.</i>"),
+  _("Tap: Deal 1 damage to any target. Activate only as a sorcery."),
+  _("At the beginning of your upkeep, you may return target card from your graveyard to your hand. If you do, lose 2 life."),
+  _("Whenever another creature dies, put a +1/+1 counter on this card."),
+};
+static const Color card_colors[] = {
+  Color(200, 40, 40), Color(40, 90, 200), Color(40, 160, 60), Color(220, 200, 140), Color(60, 60, 60),
+};
+
+/// Generate a set with a deterministic collection of cards
+static SetP make_benchmark_set(const StyleSheetP& stylesheet, int card_count) {
+  SetP set = make_intrusive<Set>(stylesheet);
+  const int fragment_count = sizeof(rule_text_fragments) / sizeof(rule_text_fragments[0]);
+  const int color_count    = sizeof(card_colors) / sizeof(card_colors[0]);
+  for (int i = 0 ; i < card_count ; ++i) {
+    CardP card = make_intrusive<Card>(*set->game);
+    card->value<TextValue>(_("name")).value.assign(String::Format(_("Benchmark card %d"), i + 1));
+    card->value<TextValue>(_("type line")).value.assign(i % 3 == 0 ? _("creature") : i % 3 == 1 ? _("spell") : _("artifact"));
+    // card i gets (i % 5) + 1 paragraphs of rule text
+    String text;
+    for (int j = 0 ; j <= i % 5 ; ++j) {
+      if (j > 0) text += _("\n");
+      text += rule_text_fragments[(i + 2 * j) % fragment_count];
+    }
+    card->value<TextValue>(_("rule text")).value.assign(text);
+    card->value<ColorValue>(_("color")).value.assign(card_colors[i % color_count]);
+    set->cards.push_back(card);
+  }
+  set->validate();
+  return set;
+}
+
+// ----------------------------------------------------------------------------- : Symbol import
+
+/// Generate a black and white image of a grid of wobbly rings, for tracing with image_to_symbol
+/** Each ring gives an outer shape and a hole, with curved edges of many pixels. */
+static Image make_import_image(int size) {
+  Image img(size, size);
+  Byte* data = img.GetData();
+  const int grid = 5;
+  double cell = double(size) / grid;
+  for (int y = 0 ; y < size ; ++y) {
+    for (int x = 0 ; x < size ; ++x) {
+      int gx = min(grid - 1, int(x / cell)), gy = min(grid - 1, int(y / cell));
+      double dx = x - (gx + 0.5) * cell, dy = y - (gy + 0.5) * cell;
+      double r = sqrt(dx * dx + dy * dy) / cell;
+      double wobble = 0.03 * sin((3 + gx + gy) * atan2(dy, dx));
+      bool inside = r < 0.42 + wobble && r > 0.2 - wobble;
+      Byte v = inside ? 0 : 255;
+      *data++ = v; *data++ = v; *data++ = v;
+    }
+  }
+  return img;
+}
+
+// ----------------------------------------------------------------------------- : Script evaluation
+
+/// Script for timing the script interpreter itself
+/** Mostly variables, arithmetic, loops and calls of script functions, where the time goes to
+ *  pushing and popping values and reference counting, not to builtin functions.
+ */
+static const Char* benchmark_script =
+  _("fib    := { if input <= 1 then 1 else fib(input - 1) + fib(input - 2) }\n")
+  _("label  := { \"{input}: \" + (if input mod 2 == 0 then \"even\" else \"odd\") }@(input: 0)\n")
+  _("sum    := for x from 1 to 5000 do x * 3 mod 7\n")
+  _("text   := for each w in [\"flying\",\"haste\",\"trample\",\"reach\"] do \"<b>{w}</b>, \"\n")
+  _("labels := for x from 1 to 500 do label(input: x)\n")
+  _("fib(16) + sum + length(text) + length(labels)\n");
+
+// ----------------------------------------------------------------------------- : Text layout
+
+/// Viewer that lays out the text fields of a card without drawing them
+class BenchmarkViewer : public DataViewer {
+public:
+  Rotation getRotation() const override {
+    if (!stylesheet) stylesheet = set->stylesheet;
+    return Rotation(0, stylesheet->getCardRect(), 1.0, 1.0, ROTATION_ATTACH_TOP_LEFT);
+  }
+
+  /// Discard the layout of all text fields and lay them out again
+  void layoutText(RotatedDC& dc) {
+    FOR_EACH(v, viewers) {
+      TextValueViewer* tv = dynamic_cast<TextValueViewer*>(v.get());
+      if (tv && tv->isVisible()) {
+        Rotater r(dc, tv->getRotation());
+        tv->onValueChange();
+        tv->prepare(dc);
+      }
+    }
+  }
+};
+
+// ----------------------------------------------------------------------------- : Running
+
+static String json_quote(const String& str) {
+  String ret = _("\"");
+  FOR_EACH_CONST(c, str) {
+    if (c == _('"') || c == _('\\')) ret += _('\\');
+    ret += c;
+  }
+  return ret + _("\"");
+}
+
+int run_benchmark(const vector<String>& args) {
+  BenchmarkOptions opt;
+  parse_options(args, opt);
+  if (!opt.data_dir.empty()) {
+    package_manager.setLocalDirectory(opt.data_dir);
+  }
+
+  StageTimings t_load   (_("load_packages"));
+  StageTimings t_save   (_("set_save"));
+  StageTimings t_open   (_("set_open"));
+  StageTimings t_update (_("update_all"));
+  StageTimings t_export (_("export_bitmap"));
+  StageTimings t_layout (_("text_layout"));
+  StageTimings t_symbol (_("symbol_render"));
+  StageTimings t_import (_("symbol_import"));
+  StageTimings t_script (_("script_eval"));
+  GoldenResults golden;
+
+  // load game and stylesheet
+  GameP game;
+  StyleSheetP stylesheet;
+  t_load.time([&]{
+    game = Game::byName(opt.game);
+    stylesheet = StyleSheet::byGameAndName(*game, opt.stylesheet);
+  });
+
+  // save and reopen the set, the opened set is used for the rest of the benchmark
+  SetP set = make_benchmark_set(stylesheet, opt.cards);
+  String set_file = wxFileName::GetTempDir() + _("/mse-benchmark.mse-set");
+  for (int i = 0 ; i < opt.iterations ; ++i) {
+    t_save.time([&]{ set->saveAs(set_file, false); });
+  }
+  for (int i = 0 ; i < opt.iterations ; ++i) {
+    t_open.time([&]{ set = import_set(set_file); });
+  }
+  SmallObjectPoolStats pool_before = small_object_pool_stats();
+  size_t memo_hits_before = script_memo_hits, memo_misses_before = script_memo_misses;
+  for (int i = 0 ; i < opt.iterations ; ++i) {
+    t_update.time([&]{ set->updateAll(); });
+  }
+  SmallObjectPoolStats pool_after = small_object_pool_stats();
+  size_t memo_hits = script_memo_hits - memo_hits_before, memo_misses = script_memo_misses - memo_misses_before;
+
+  // render all cards
+  for (size_t i = 0 ; i < set->cards.size() ; ++i) {
+    Bitmap bitmap;
+    t_export.time([&]{ bitmap = export_bitmap(set, set->cards[i], 1.0, 0.0); });
+    if ((int)i < opt.golden_cards) {
+      check_golden(opt, String::Format(_("card-%03d.png"), (int)i + 1), bitmap.ConvertToImage(), golden);
+    }
+  }
+
+  // text layout
+  BenchmarkViewer viewer;
+  viewer.setSet(set);
+  FOR_EACH(card, set->cards) {
+    viewer.setCard(card);
+    set->updateStyles(card, false);
+    RealSize size = viewer.getRotation().getExternalSize();
+    Bitmap bitmap((int)size.width, (int)size.height);
+    wxMemoryDC dc;
+    dc.SelectObject(bitmap);
+    RotatedDC rdc(dc, viewer.getRotation(), QUALITY_AA);
+    t_layout.time([&]{ viewer.layoutText(rdc); });
+    dc.SelectObject(wxNullBitmap);
+  }
+
+  // symbol rendering
+  if (!opt.symbol.empty() && wxFileExists(opt.symbol)) {
+    SymbolP symbol;
+    wxFileInputStream stream(opt.symbol);
+    Reader reader(stream, nullptr, opt.symbol);
+    reader.handle_greedy(symbol);
+    SolidFillSymbolFilter filter(Color(0,0,0), Color(255,255,255));
+    int sizes[] = {50, 100, 200, 400};
+    for (int size : sizes) {
+      Image img;
+      for (int i = 0 ; i < opt.iterations ; ++i) {
+        t_symbol.time([&]{ img = render_symbol(symbol, filter, 0.05, size, size); });
+      }
+      check_golden(opt, String::Format(_("symbol-%d.png"), size), img, golden);
+    }
+  }
+  // tracing and simplifying a large image
+  if (opt.import_size > 0) {
+    Image img = make_import_image(opt.import_size);
+    for (int i = 0 ; i < opt.iterations ; ++i) {
+      Image copy = img.Copy(); // image_to_symbol destroys the image
+      t_import.time([&]{
+        SymbolP symbol = image_to_symbol(copy);
+        simplify_symbol(*symbol);
+      });
+    }
+  }
+  wxRemoveFile(set_file);
+  // the script interpreter, with a context that is not attached to a set
+  {
+    ScriptP script = parse(benchmark_script);
+    Context ctx;
+    init_script_functions(ctx);
+    for (int i = 0 ; i < 10 * opt.iterations ; ++i) {
+      t_script.time([&]{ ctx.eval(*script); });
+    }
+  }
+
+  // report
+  String json = _("{\n");
+  json += String::Format(_("  \"version\": \"%s\",\n"), app_version.toString());
+  json += String::Format(_("  \"game\": %s,\n  \"stylesheet\": %s,\n"), json_quote(opt.game), json_quote(opt.stylesheet));
+  json += String::Format(_("  \"cards\": %d,\n  \"iterations\": %d,\n"), (int)set->cards.size(), opt.iterations);
+  json += _("  \"stages\": {\n");
+  StageTimings* stages[] = {&t_load, &t_save, &t_open, &t_update, &t_export, &t_layout, &t_symbol, &t_import, &t_script};
+  for (size_t i = 0 ; i < sizeof(stages) / sizeof(stages[0]) ; ++i) {
+    json += _("    ") + json_quote(stages[i]->name) + _(": ") + stages[i]->toJSON();
+    json += i + 1 < sizeof(stages) / sizeof(stages[0]) ? _(",\n") : _("\n");
+  }
+  json += _("  },\n");
+  // allocations of script values and other small objects while updating, per iteration
+  json += String::Format(_("  \"update_allocations\": {\"pool\":%.1f,\"system\":%.1f,\"system_bytes\":%.1f},\n"),
+                         double(pool_after.allocations        - pool_before.allocations)        / max(1, opt.iterations),
+                         double(pool_after.system_allocations - pool_before.system_allocations) / max(1, opt.iterations),
+                         double(pool_after.system_bytes       - pool_before.system_bytes)       / max(1, opt.iterations));
+  // calls to pure script functions while updating, per iteration
+  json += String::Format(_("  \"update_memo\": {\"hits\":%.1f,\"misses\":%.1f},\n"),
+                         double(memo_hits)   / max(1, opt.iterations),
+                         double(memo_misses) / max(1, opt.iterations));
+  json += String::Format(_("  \"golden\": {\"compared\":%d,\"missing\":%d,\"written\":%d,\"failures\":["),
+                         golden.compared, golden.missing, golden.written);
+  for (size_t i = 0 ; i < golden.failures.size() ; ++i) {
+    if (i > 0) json += _(",");
+    json += json_quote(golden.failures[i]);
+  }
+  json += _("]}\n}\n");
+
+  if (opt.output.empty()) {
+    cli << json;
+    cli.flush();
+  } else {
+    wxFileOutputStream file(opt.output);
+    if (!file.IsOk()) throw Error(_("Unable to open file for writing: ") + opt.output);
+    wxTextOutputStream stream(file, wxEOL_UNIX, wxConvUTF8);
+    stream << json;
+  }
+  bool ok = golden.failures.empty();
+  if (opt.require_golden && !opt.update_golden && (golden.missing > 0 || golden.compared == 0)) {
+    queue_message(MESSAGE_ERROR, String::Format(_("%d golden images are missing from '%s', run with --update-golden to create them"), golden.missing, opt.golden_dir));
+    ok = false;
+  } else if (golden.missing > 0) {
+    queue_message(MESSAGE_WARNING, String::Format(_("%d golden images are missing, run with --update-golden to create them"), golden.missing));
+  }
+  FOR_EACH(failure, golden.failures) {
+    queue_message(MESSAGE_ERROR, _("Rendering differs from golden image: ") + failure);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
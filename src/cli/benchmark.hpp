@@ -0,0 +1,21 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+// ----------------------------------------------------------------------------- : Rendering benchmark
+
+/// Run the headless rendering benchmark
+/** args are the command line arguments following "--benchmark".
+ *  The timings are written as JSON, to stdout or to the file given with --output.
+ *  Returns EXIT_FAILURE if a rendered card differs from its golden image,
+ *  or with --require-golden if the golden images are missing.
+ */
+int run_benchmark(const vector<String>& args);
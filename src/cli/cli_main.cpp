@@ -13,15 +13,19 @@
 #include <script/functions/functions.hpp>
 #include <script/profiler.hpp>
 #include <data/format/formats.hpp>
+#include <data/game.hpp>
 #include <wx/process.h>
 #include <wx/wfstream.h>
+#include <wx/filename.h>
 
 String read_utf8_line(wxInputStream& input, bool until_eof = false);
+ScriptValueP export_set(SetP const& set, vector<CardP> const& cards, ExportTemplateP const& exp, String const& outname);
 
 // ----------------------------------------------------------------------------- : Command line interface
 
-CLISetInterface::CLISetInterface(const SetP& set, bool quiet, bool run)
+CLISetInterface::CLISetInterface(const SetP& set, bool quiet, bool run, bool batch)
   : quiet(quiet)
+  , batch(batch)
   , our_context(nullptr)
 {
   if (!cli.haveConsole()) {
@@ -114,6 +118,47 @@ void CLISetInterface::run() {
     cli.flush();
     cli.flushRaw();
   }
+  // images might still be written in batch mode
+  try {
+    finishWrites();
+  } catch (const Error& e) {
+    cli.show_message(MESSAGE_ERROR,e.what());
+  }
+  cli.print_pending_errors();
+  cli.flush();
+  cli.flushRaw();
+}
+
+void CLISetInterface::finishWrites() {
+  ei.image_writes.finish();
+}
+
+/// Maximum number of parsed commands to remember
+const size_t MAX_PARSED_SCRIPTS = 256;
+
+ScriptP CLISetInterface::parseCached(const String& code) {
+  auto it = parsed_scripts.find(code);
+  if (it != parsed_scripts.end()) return it->second;
+  vector<ScriptParseError> errors;
+  ScriptP script = parse(code,nullptr,false,errors);
+  if (!errors.empty()) {
+    FOR_EACH(error,errors) cli.show_message(MESSAGE_ERROR,error.what());
+    return ScriptP();
+  }
+  if (parsed_scripts.size() >= MAX_PARSED_SCRIPTS) parsed_scripts.clear();
+  parsed_scripts[code] = script;
+  return script;
+}
+
+ScriptP CLISetInterface::parseFileCached(const String& filename) {
+  String path = wxFileName(filename).GetFullPath();
+  if (!wxFileExists(path)) throw FileNotFoundError(_("<unknown>"), filename);
+  time_t modified = wxFileModificationTime(path);
+  auto it = parsed_script_files.find(path);
+  if (it != parsed_script_files.end() && it->second.first == modified) return it->second.second;
+  ScriptP script = parseCached(read_file(path));
+  if (script) parsed_script_files[path] = make_pair(modified, script);
+  return script;
 }
 
 void CLISetInterface::showWelcome() {
@@ -131,11 +176,23 @@ void CLISetInterface::showUsage() {
   cli << _("   <expression>        Execute a script expression, display the result\n");
   cli << _("   :help               Show this help page.\n");
   cli << _("   :load <setfile>     Load a different set file.\n");
+  cli << _("   :save [<setfile>]   Save the set, optionally under a new name.\n");
+  cli << _("   :export <template> [<outfile>]\n");
+  cli << _("                       Export the set using an export template.\n");
+  cli << _("   :images [<image>]   Export the card images, <image> is a filename script.\n");
+  cli << _("   :run <scriptfile>   Execute a script file with the current set.\n");
+  cli << _("   :wait               Wait until all image files have been written.\n");
   cli << _("   :quit               Exit the MSE command line interface.\n");
   cli << _("   :reset              Clear all local variable definitions.\n");
   cli << _("   :pwd                Print the current working directory.\n");
   cli << _("   :cd                 Change the working directory.\n");
   cli << _("   :! <command>        Perform a shell command.\n");
+  #if USE_SCRIPT_PROFILING
+    cli << _("   :profile [<level>]  Show profiling statistics, up to the given depth.\n");
+    cli << _("   :profile on|off     Enable or disable the profiler.\n");
+    cli << _("   :profile trace      Start recording a trace of all profiled calls.\n");
+    cli << _("   :profile save <f>   Write the recorded trace to a file, in Chrome trace format.\n");
+  #endif
   cli << _("\n Commands can be abreviated to their first letter if there is no ambiguity.\n\n");
 }
 
@@ -161,6 +218,47 @@ void CLISetInterface::handleCommand(const String& command) {
         } else {
           setSet(import_set(arg));
         }
+      } else if (before == _(":s") || before == _(":save")) {
+        if (!set) {
+          cli.show_message(MESSAGE_ERROR,_("No set loaded."));
+        } else if (arg.empty()) {
+          set->save();
+        } else {
+          set->saveAs(arg);
+        }
+      } else if (before == _(":e") || before == _(":export")) {
+        size_t space2 = min(arg.find_first_of(_(' ')), arg.size());
+        String out = space2 + 1 < arg.size() ? arg.substr(space2+1) : String();
+        if (!set) {
+          cli.show_message(MESSAGE_ERROR,_("No set loaded."));
+        } else if (arg.empty()) {
+          cli.show_message(MESSAGE_ERROR,_("Give an export template."));
+        } else {
+          ExportTemplateP exp = ExportTemplate::byName(arg.substr(0,space2));
+          ScriptValueP result = export_set(set, set->cards, exp, out);
+          if (out.empty()) {
+            cli << result->toString() << ENDL;
+          }
+        }
+      } else if (before == _(":images")) {
+        if (!set) {
+          cli.show_message(MESSAGE_ERROR,_("No set loaded."));
+        } else {
+          String out = arg.empty() ? settings.gameSettingsFor(*set->game).images_export_filename : arg;
+          export_images(set, set->cards, out, CONFLICT_NUMBER_OVERWRITE, &ei.image_writes);
+          if (!batch) finishWrites();
+        }
+      } else if (before == _(":run")) {
+        if (arg.empty()) {
+          cli.show_message(MESSAGE_ERROR,_("Give a script file to run."));
+        } else if (ScriptP script = parseFileCached(arg)) {
+          WITH_DYNAMIC_ARG(export_info, &ei);
+          ScriptValueP result = getContext().eval(*script,false);
+          if (!batch) finishWrites();
+          cli << result->toCode() << ENDL;
+        }
+      } else if (before == _(":w") || before == _(":wait")) {
+        finishWrites();
       } else if (before == _(":r") || before == _(":reset")) {
         Context& ctx = getContext();
         ei.exported_images.clear();
@@ -204,7 +302,14 @@ void CLISetInterface::handleCommand(const String& command) {
         }
       #if USE_SCRIPT_PROFILING
         } else if (before == _(":profile")) {
-          if (arg == _("full")) {
+          if (arg == _("on") || arg == _("off")) {
+            set_profiling_enabled(arg == _("on"));
+          } else if (arg == _("trace")) {
+            profile_trace_start();
+          } else if (arg.StartsWith(_("save "))) {
+            profile_trace_stop();
+            profile_trace_write(arg.substr(5));
+          } else if (arg == _("full")) {
             showProfilingStats(profile_root);
           } else {
             long level = 1;
@@ -221,16 +326,13 @@ void CLISetInterface::handleCommand(const String& command) {
       cli << _("Use :help for help\n");
     } else {
       // parse command
-      vector<ScriptParseError> errors;
-      ScriptP script = parse(command,nullptr,false,errors);
-      if (!errors.empty()) {
-        FOR_EACH(error,errors) cli.show_message(MESSAGE_ERROR,error.what());
-        return;
-      }
+      ScriptP script = parseCached(command);
+      if (!script) return;
       // execute command
       WITH_DYNAMIC_ARG(export_info, &ei);
       Context& ctx = getContext();
       ScriptValueP result = ctx.eval(*script,false);
+      if (!batch) finishWrites();
       // show result
       cli << result->toCode() << ENDL;
     }
@@ -243,11 +345,11 @@ void CLISetInterface::handleCommand(const String& command) {
   void CLISetInterface::showProfilingStats(const FunctionProfile& item, int level) {
     // show parent
     if (level == 0) {
-      cli << GRAY << _("Time(s)   Avg (ms)  Calls   Function") << ENDL;
-      cli <<         _("========  ========  ======  ===============================") << NORMAL << ENDL;
+      cli << GRAY << _("Time(s)   Avg (ms)  Calls   Memo    Allocs    Function") << ENDL;
+      cli <<         _("========  ========  ======  ======  ========  ===============================") << NORMAL << ENDL;
     } else {
       for (int i = 1 ; i < level ; ++i) cli << _("  ");
-      cli << String::Format(_("%8.5f  %8.5f  %6d  %s"), item.total_time(), 1000 * item.avg_time(), item.calls, item.name.c_str()) << ENDL;
+      cli << String::Format(_("%8.5f  %8.5f  %6d  %6d  %8lu  %s"), item.total_time(), 1000 * item.avg_time(), item.calls, item.memo_hits, (unsigned long)item.allocations, item.name.c_str()) << ENDL;
     }
     // show children
     vector<FunctionProfileP> children;
@@ -18,7 +18,11 @@
 class CLISetInterface : public SetView {
 public:
   /// The set is optional
-  CLISetInterface(const SetP& set, bool quiet = false, bool run = true);
+  /** In batch mode image files are written in the background while the next commands run,
+   *  use the :wait command to wait for them. Loaded packages and parsed scripts are kept between commands,
+   *  so a long list of jobs can be processed by a single process.
+   */
+  CLISetInterface(const SetP& set, bool quiet = false, bool run = true, bool batch = false);
 protected:
   void onAction(const Action&, bool) override {}
   void onChangeSet() override;
@@ -26,11 +30,22 @@ protected:
 private:
   bool quiet;    ///< Supress prompts and other non-vital stuff
   bool running;  ///< Still running?
+  bool batch;    ///< Don't wait for image files to be written after each command
   
   void run();
   void showWelcome();
   void showUsage();
   void handleCommand(const String& command);
+  /// Wait until all images have been written
+  void finishWrites();
+  
+  /// Parse a script, or reuse an earlier parse of the same code
+  /** Returns nullptr if there are errors, they are shown to the user. */
+  ScriptP parseCached(const String& code);
+  /// Parse a script file, or reuse an earlier parse if the file has not changed
+  ScriptP parseFileCached(const String& filename);
+  map<String, ScriptP> parsed_scripts;                    ///< Cache for parseCached
+  map<String, pair<time_t, ScriptP>> parsed_script_files; ///< Cache for parseFileCached
   #if USE_SCRIPT_PROFILING
     void showProfilingStats(const FunctionProfile& parent, int level = 0);
   #endif
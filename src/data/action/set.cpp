@@ -10,6 +10,7 @@
 #include <data/action/set.hpp>
 #include <data/set.hpp>
 #include <data/card.hpp>
+#include <data/field.hpp>
 #include <data/pack.hpp>
 #include <data/stylesheet.hpp>
 #include <util/error.hpp>
@@ -39,6 +40,18 @@ void AddCardAction::perform(bool to_undo) {
   action.perform(set.cards, to_undo);
 }
 
+size_t AddCardAction::memoryUsage() const {
+  // while undone (or after removing), the cards are only kept alive by this action
+  size_t bytes = sizeof(*this);
+  FOR_EACH_CONST(step, action.steps) {
+    bytes += sizeof(Card);
+    FOR_EACH_CONST(v, step.item->data) {
+      bytes += sizeof(Value) + v->toString().size() * sizeof(Char);
+    }
+  }
+  return bytes;
+}
+
 
 // ----------------------------------------------------------------------------- : Reorder cards
 
@@ -46,6 +46,7 @@ public:
   
   String getName(bool to_undo) const override;
   void perform(bool to_undo) override;
+  size_t memoryUsage() const override;
   
   const GenericAddAction<CardP> action;
 };
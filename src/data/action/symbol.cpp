@@ -53,6 +53,7 @@ void SymbolPartMoveAction::movePart(SymbolPart& part) {
     FOR_EACH(pnt, s->points) {
       pnt->pos -= moved;
     }
+    s->segments.translate(-moved);
   } else if (SymbolSymmetry* s = part.isSymbolSymmetry()) {
     s->center -= moved;
   }
@@ -112,15 +112,44 @@ unique_ptr<ValueAction> value_action(const MultipleChoiceValueP& value, const De
 TextValueAction::TextValueAction(const TextValueP& value, size_t start, size_t end, size_t new_end, const Defaultable<String>& new_value, const String& name)
   : ValueAction(value)
   , selection_start(start), selection_end(end), new_selection_end(new_end)
-  , new_value(new_value)
   , name(name)
-{}
+{
+  setDiff(new_value);
+}
 
 String TextValueAction::getName(bool to_undo) const { return name; }
 
+void TextValueAction::setDiff(const Defaultable<String>& other) {
+  const String& cur = value().value();
+  const String& oth = other();
+  // If a script can change the value after this action, or the default value can change,
+  // then we can't rely on the unchanged parts staying the same, so store the whole text.
+  bool whole = value().field().script || value().value.isDefault() || other.isDefault();
+  size_t max_len = whole ? 0 : min(cur.size(), oth.size());
+  diff_start = 0;
+  while (diff_start < max_len && cur[diff_start] == oth[diff_start]) ++diff_start;
+  diff_end = 0;
+  while (diff_end < max_len - diff_start && cur[cur.size() - diff_end - 1] == oth[oth.size() - diff_end - 1]) ++diff_end;
+  diff_text = oth.substr(diff_start, oth.size() - diff_start - diff_end);
+  other_default = other.isDefault();
+}
+
+String TextValueAction::applyDiff(const String& str) const {
+  return str.substr(0, diff_start) + diff_text + str.substr(str.size() - diff_end);
+}
+
+String TextValueAction::newValue() const {
+  return applyDiff(value().value());
+}
+
 void TextValueAction::perform(bool to_undo) {
   ValueAction::perform(to_undo);
-  swap_value(value(), new_value);
+  const String& cur = value().value();
+  Defaultable<String> other(applyDiff(cur), other_default);
+  String replaced = cur.substr(diff_start, cur.size() - diff_start - diff_end);
+  swap_value(value(), other);
+  diff_text = replaced;
+  other_default = other.isDefault();
   swap(selection_end, new_selection_end);
   valueP->onAction(*this, to_undo); // notify value
 }
@@ -128,14 +157,21 @@ void TextValueAction::perform(bool to_undo) {
 bool TextValueAction::merge(const Action& action) {
   TYPE_CASE(action, TextValueAction) {
     if (&action.value() == &value() && action.name == name) {
+      bool adjacent = false;
       if (action.selection_start == selection_end) {
         // adjacent edits, keep old value of this, it is older
         selection_end = action.selection_end;
-        return true;
+        adjacent = true;
       } else if (action.new_selection_end == selection_start && name == _ACTION_("backspace")) {
         // adjacent backspaces
         selection_start = action.selection_start;
         selection_end   = action.selection_end;
+        adjacent = true;
+      }
+      if (adjacent) {
+        // both actions have been performed, the diff of this should now go all the way back to the old value of this
+        Defaultable<String> old_value(applyDiff(action.applyDiff(value().value())), other_default);
+        setDiff(old_value);
         return true;
       }
     }
@@ -143,6 +179,10 @@ bool TextValueAction::merge(const Action& action) {
   return false;
 }
 
+size_t TextValueAction::memoryUsage() const {
+  return sizeof(*this) + (diff_text.size() + name.size()) * sizeof(Char);
+}
+
 TextValue& TextValueAction::value() const {
   return static_cast<TextValue&>(*valueP);
 }
@@ -236,6 +276,27 @@ void TextToggleReminderAction::perform(bool to_undo) {
   value.onAction(*this, to_undo); // notify value
 }
 
+// ----------------------------------------------------------------------------- : Replace all
+
+ReplaceAllAction::ReplaceAllAction(const String& name)
+  : name(name)
+{}
+
+String ReplaceAllAction::getName(bool to_undo) const { return name; }
+
+void ReplaceAllAction::perform(bool to_undo) {
+  if (to_undo) {
+    FOR_EACH_REVERSE(a, actions) a->perform(to_undo);
+  } else {
+    FOR_EACH(a, actions) a->perform(to_undo);
+  }
+}
+
+size_t ReplaceAllAction::memoryUsage() const {
+  size_t usage = sizeof(*this) + actions.capacity() * sizeof(actions[0]) + name.size() * sizeof(Char);
+  FOR_EACH_CONST(a, actions) usage += a->memoryUsage();
+  return usage;
+}
 
 // ----------------------------------------------------------------------------- : Event
 
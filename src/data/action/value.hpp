@@ -64,6 +64,8 @@ unique_ptr<ValueAction> value_action(const PackageChoiceValueP&  value, const St
 // ----------------------------------------------------------------------------- : Text
 
 /// An action that changes a TextValue
+/** Only the changed part of the text is stored, not the whole old and new values.
+ */
 class TextValueAction : public ValueAction {
 public:
   TextValueAction(const TextValueP& value, size_t start, size_t end, size_t new_end, const Defaultable<String>& new_value, const String& name);
@@ -71,8 +73,10 @@ public:
   String getName(bool to_undo) const override;
   void perform(bool to_undo) override;
   bool merge(const Action& action) override;
+  size_t memoryUsage() const override;
   
-  inline const String& newValue() const { return new_value(); }
+  /// The value after performing this action, only valid before the action is performed
+  String newValue() const;
   
   /// The modified selection
   size_t selection_start, selection_end;
@@ -80,8 +84,17 @@ private:
   inline TextValue& value() const;
   
   size_t new_selection_end;
-  Defaultable<String> new_value;
+  // The other version of the value (new before perform, old after) differs from the current one
+  // only in the part between diff_start and diff_end characters from the end of the string
+  size_t diff_start, diff_end;
+  String diff_text;     ///< The text in the other version
+  bool   other_default; ///< Is the other version the default value?
   String name;
+  
+  /// Store the difference between the current value and other
+  void setDiff(const Defaultable<String>& other);
+  /// Apply the diff to a string
+  String applyDiff(const String& str) const;
 };
 
 /// Action for toggling some formating tag on or off in some range
@@ -109,25 +122,20 @@ private:
 
 // ----------------------------------------------------------------------------- : Replace all
 
-/// A TextValueAction without the start and end stuff
-class SimpleTextValueAction : public ValueAction {
-public:
-  SimpleTextValueAction(const Card* card, const TextValueP& value, const Defaultable<String>& new_value);
-  void perform(bool to_undo) override;
-  bool merge(const SimpleTextValueAction& action);
-private:
-  Defaultable<String> new_value;
-};
-
 /// An action from "Replace All"; just a bunch of value actions performed in sequence
+/** Like for typing, each action only stores the changed part of its value.
+ */
 class ReplaceAllAction : public Action {
 public:
-  ~ReplaceAllAction();
+  ReplaceAllAction(const String& name);
   
   String getName(bool to_undo) const override;
   void perform(bool to_undo) override;
+  size_t memoryUsage() const override;
   
-  vector<SimpleTextValueAction> actions;
+  vector<unique_ptr<TextValueAction>> actions;
+private:
+  String name;
 };
 
 // ----------------------------------------------------------------------------- : Event
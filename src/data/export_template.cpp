@@ -12,6 +12,7 @@
 #include <data/set.hpp>
 #include <data/field.hpp>
 #include <util/io/package_manager.hpp>
+#include <util/error.hpp>
 
 // ----------------------------------------------------------------------------- : Export template, basics
 
@@ -48,6 +49,90 @@ IMPLEMENT_REFLECTION(ExportTemplate) {
   REFLECT(script);
 }
 
+// ----------------------------------------------------------------------------- : ImageWriteQueue
+
+class ImageWriteQueue::Worker : public wxThread {
+public:
+  Worker(ImageWriteQueue& queue) : wxThread(wxTHREAD_JOINABLE), queue(queue) {}
+  
+  ExitCode Entry() override {
+    wxMutexLocker lock(queue.mutex);
+    while (true) {
+      while (queue.jobs.empty() && !queue.stopping) {
+        queue.work_available.Wait();
+      }
+      if (queue.jobs.empty()) return 0; // stopping, and all work is done
+      pair<Image,String> job = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+      queue.busy++;
+      // encode and write without holding the lock
+      queue.mutex.Unlock();
+      bool ok = job.first.SaveFile(job.second);
+      queue.mutex.Lock();
+      if (!ok) queue.error += _("\n") + job.second;
+      queue.busy--;
+      queue.work_done.Broadcast();
+    }
+  }
+  
+private:
+  ImageWriteQueue& queue;
+};
+
+ImageWriteQueue::ImageWriteQueue()
+  : work_available(mutex)
+  , work_done(mutex)
+  , busy(0)
+  , stopping(false)
+{}
+
+ImageWriteQueue::~ImageWriteQueue() {
+  {
+    wxMutexLocker lock(mutex);
+    stopping = true;
+    work_available.Broadcast();
+  }
+  FOR_EACH(w, workers) {
+    w->Wait();
+    delete w;
+  }
+}
+
+void ImageWriteQueue::write(const Image& image, const String& filename) {
+  // wxImage reference counting is not thread safe, so give the worker its own copy
+  Image copy = image.Copy();
+  wxMutexLocker lock(mutex);
+  jobs.push_back(make_pair(copy, filename));
+  // start another worker if all of them are busy
+  size_t max_workers = (size_t)max(1, min(8, wxThread::GetCPUCount()));
+  if (workers.size() < max_workers && busy + jobs.size() > workers.size()) {
+    Worker* w = new Worker(*this);
+    if (w->Run() == wxTHREAD_NO_ERROR) {
+      workers.push_back(w);
+    } else {
+      delete w;
+      if (workers.empty()) {
+        // no threads, write it ourselves
+        jobs.pop_back();
+        if (!copy.SaveFile(filename)) error += _("\n") + filename;
+      }
+    }
+  }
+  work_available.Signal();
+}
+
+void ImageWriteQueue::finish() {
+  wxMutexLocker lock(mutex);
+  while (!jobs.empty() || busy > 0) {
+    work_done.Wait();
+  }
+  if (!error.empty()) {
+    String files = error;
+    error.clear();
+    throw Error(_("Unable to write image files:") + files);
+  }
+}
+
 // ----------------------------------------------------------------------------- : ExportInfo
 
 IMPLEMENT_DYNAMIC_ARG(ExportInfo*, export_info, nullptr);
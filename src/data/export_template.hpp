@@ -11,6 +11,7 @@
 #include <util/prec.hpp>
 #include <util/io/package.hpp>
 #include <script/scriptable.hpp>
+#include <wx/thread.h>
 
 DECLARE_POINTER_TYPE(Game);
 DECLARE_POINTER_TYPE(Set);
@@ -43,6 +44,35 @@ private:
   DECLARE_REFLECTION();
 };
 
+// ----------------------------------------------------------------------------- : ImageWriteQueue
+
+/// Encodes and writes images on background threads
+/** Export scripts can continue rendering while earlier images are being saved.
+ *  Call finish() to wait until all images are written.
+ */
+class ImageWriteQueue {
+public:
+  ImageWriteQueue();
+  /// Waits for all pending writes
+  ~ImageWriteQueue();
+  
+  /// Write an image to a file, the image is copied so the caller can keep using it
+  void write(const Image& image, const String& filename);
+  /// Wait until all images are written, throws an Error if one of them failed
+  void finish();
+  
+private:
+  class Worker;
+  wxMutex                   mutex;
+  wxCondition               work_available; ///< Signaled when a job is added or when stopping
+  wxCondition               work_done;      ///< Signaled when a job is completed
+  deque<pair<Image,String>> jobs;           ///< Images waiting to be written
+  vector<Worker*>           workers;        ///< Started on demand
+  size_t                    busy;           ///< Number of jobs being written
+  bool                      stopping;
+  String                    error;          ///< Files that could not be written
+};
+
 // ----------------------------------------------------------------------------- : ExportInfo
 
 /// Information that can be used by export functions
@@ -57,6 +87,7 @@ struct ExportInfo {
   String             directory_absolute; ///< The absolute path of the directory
   map<String,wxSize> exported_images;     ///< Images (from symbol font) already exported, and their size
   bool               allow_writes_outside; ///< Can files outside the directory be written to?
+  ImageWriteQueue    image_writes;       ///< Images written by the export script, finish() before the export is done
 };
 
 DECLARE_DYNAMIC_ARG(ExportInfo*, export_info);
@@ -13,6 +13,7 @@
 #include <data/settings.hpp>
 
 class Game;
+class ImageWriteQueue;
 DECLARE_POINTER_TYPE(Set);
 DECLARE_POINTER_TYPE(Card);
 
@@ -92,8 +93,16 @@ FileFormatP mtg_editor_file_format();
 void export_images(Window* parent, const SetP& set);
 
 /// Export the image for each card in a list of cards
+/** If writes is given, the files are written by that queue, otherwise they are written before returning */
 void export_images(const SetP& set, const vector<CardP>& cards,
-                   const String& path, const String& filename_template, FilenameConflicts conflicts);
+                   const String& path, const String& filename_template, FilenameConflicts conflicts,
+                   ImageWriteQueue* writes = nullptr);
+
+/// Export the image for each card in a list of cards
+/** The filename template can start with a directory, which is created if needed */
+void export_images(const SetP& set, const vector<CardP>& cards,
+                   const String& filename_template, FilenameConflicts conflicts,
+                   ImageWriteQueue* writes = nullptr);
 
 /// Export the image of a single card
 void export_image(const SetP& set, const CardP& card, const String& filename);
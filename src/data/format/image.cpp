@@ -13,6 +13,7 @@
 #include <data/card.hpp>
 #include <data/stylesheet.hpp>
 #include <data/settings.hpp>
+#include <data/export_template.hpp>
 #include <render/card/viewer.hpp>
 #include <wx/filename.h>
 
@@ -104,7 +105,8 @@ Bitmap export_bitmap(const SetP& set, const CardP& card, const double zoom, cons
 
 
 void export_images(const SetP& set, const vector<CardP>& cards,
-                   const String& path, const String& filename_template, FilenameConflicts conflicts)
+                   const String& path, const String& filename_template, FilenameConflicts conflicts,
+                   ImageWriteQueue* writes)
 {
   wxBusyCursor busy;
   // Script
@@ -125,6 +127,27 @@ void export_images(const SetP& set, const vector<CardP>& cards,
     // write image
     filename = fn.GetFullPath();
     used.insert(filename);
-    export_image(set, card, filename);
+    if (writes) {
+      writes->write(export_bitmap(set, card).ConvertToImage(), filename);
+    } else {
+      export_image(set, card, filename);
+    }
   }
 }
+
+void export_images(const SetP& set, const vector<CardP>& cards,
+                   const String& filename_template, FilenameConflicts conflicts,
+                   ImageWriteQueue* writes)
+{
+  // split off the directory, the rest of the template is used for each file name
+  String path = _(".");
+  String name_template = filename_template;
+  size_t pos = filename_template.find_last_of(_("/\\"));
+  if (pos != String::npos) {
+    path = filename_template.substr(0, pos);
+    if (!wxDirExists(path)) wxMkdir(path);
+    path += _("/x"); // wxFileName needs a file name after the directory
+    name_template = filename_template.substr(pos + 1);
+  }
+  export_images(set, cards, path, name_template, conflicts, writes);
+}
@@ -18,6 +18,9 @@
 #include <gfx/bezier.hpp>
 #include <util/error.hpp>
 #include <util/platform.hpp>
+#include <wx/thread.h>
+#include <queue>
+#include <atomic>
 
 // ----------------------------------------------------------------------------- : Image preprocessing
 
@@ -126,9 +129,13 @@ struct ImageData {
   }
 };
 
+/// Find the next point to start tracing a shape from
+/** The search continues from (x_out,y_out).
+ *  Cells are only ever marked, never unmarked, so nothing before the previous start can become a new start.
+ */
 bool find_symbol_shape_start(const ImageData& data, int& x_out, int& y_out) {
-  for (int x = 0 ; x < data.width ; ++x) {
-    for (int y = 0 ; y < data.height ; ++y) {
+  for (int x = x_out ; x < data.width ; ++x) {
+    for (int y = x == x_out ? y_out : 0 ; y < data.height ; ++y) {
       if (data(x, y) == FULL && data(x, y-1) == EMPTY) {
         // the point above must be clear, we don't want to start in the 'ground'
         // also, we don't want to find things we found before
@@ -141,10 +148,11 @@ bool find_symbol_shape_start(const ImageData& data, int& x_out, int& y_out) {
   return false;
 }
 
-SymbolShapeP read_symbol_shape(const ImageData& data) {
+/// Trace the next shape in the image, (x_scan,y_scan) is where the search for a starting point continues
+SymbolShapeP read_symbol_shape(const ImageData& data, int& x_scan, int& y_scan) {
   // find start point
-  int xs, ys;
-  if (!find_symbol_shape_start(data, xs, ys))  return SymbolShapeP();
+  if (!find_symbol_shape_start(data, x_scan, y_scan))  return SymbolShapeP();
+  int xs = x_scan, ys = y_scan;
   data(xs, ys) |= MARKED;
   
   SymbolShapeP shape(new SymbolShape);
@@ -212,8 +220,9 @@ SymbolP image_to_symbol(Image& img) {
   // 2. read as many symbol shapes as we can
   ImageData data = {w,h,img.GetData()};
   SymbolP symbol(new Symbol);
+  int x_scan = 0, y_scan = 0;
   while (true) {
-    SymbolShapeP shape = read_symbol_shape(data);
+    SymbolShapeP shape = read_symbol_shape(data, x_scan, y_scan);
     if (!shape) break;
     symbol->parts.push_back(shape);
   }
@@ -389,36 +398,8 @@ void merge_lines(SymbolShape& shape) {
   }
 }
 
-double cost_of_point_removal(SymbolShape& shape, int i);
-void remove_point(SymbolShape& shape, int i);
-
-/// Simplify a symbol shape by removing points
-/** Always remove the point with the lowest cost,
- *  stop when the cost becomes too high
- */
-void remove_points(SymbolShape& shape) {
-  const double treshold = 0.0002; // maximum cost
-  while (true) {
-    // Find the point with the lowest cost of removal
-    int best = -1;
-    double best_cost = 1e100;
-    for (int i = 0 ; (size_t)i < shape.points.size() ; ++i) {
-      double cost = cost_of_point_removal(shape, i); 
-      if (cost < best_cost) {
-        best_cost = cost;
-        best = i;
-      }
-    }
-    if (best_cost > treshold) break;
-    // ... and remove it
-    remove_point(shape, best);
-  }
-}
-/// Cost of removing point i from a symbol shape
-double cost_of_point_removal(SymbolShape& shape, int i) {
-  ControlPoint& cur  = *shape.getPoint(i);
-  ControlPoint& prev = *shape.getPoint(i-1);
-  ControlPoint& next = *shape.getPoint(i+1);
+/// Cost of removing point cur, which lies between prev and next
+double cost_of_point_removal(const ControlPoint& prev, const ControlPoint& cur, const ControlPoint& next) {
   if (cur.lock != LOCK_DIR) return 1e100; // don't remove corners
   
   Vector2D before = cur.delta_before;
@@ -438,12 +419,9 @@ double cost_of_point_removal(SymbolShape& shape, int i) {
   // cost is distance to new point * length of line ~= area added/removed from shape
   return np.length() * ac.length();
 }
-/// Remove a point from a bezier curve
+/// Remove point cur from a bezier curve, by adjusting the handles of its neighbours
 /** See SinglePointRemoveAction for algorithm */
-void remove_point(SymbolShape& shape, int i) {
-  ControlPoint& cur  = *shape.getPoint(i);
-  ControlPoint& prev = *shape.getPoint(i-1);
-  ControlPoint& next = *shape.getPoint(i+1);
+void remove_point(ControlPoint& prev, const ControlPoint& cur, ControlPoint& next) {
   Vector2D before = cur.delta_before;
   Vector2D after  = cur.delta_after;
   // Based on SinglePointRemoveAction
@@ -453,10 +431,65 @@ void remove_point(SymbolShape& shape, int i) {
   // set new handle sizes
   prev.delta_after  *= totl / bl;
   next.delta_before *= totl / al;
-  // remove
-  shape.points.erase(shape.points.begin() + i);
 }
 
+/// Simplify a symbol shape by removing points
+/** Always remove the point with the lowest cost (the first one in case of ties),
+ *  stop when the cost becomes too high.
+ *  
+ *  The cost of a point only depends on its neighbours, so after a removal only
+ *  the costs of the two neighbours change. The points are kept in a linked list,
+ *  and the costs in a priority queue, where outdated entries are skipped.
+ */
+void remove_points(SymbolShape& shape) {
+  const double treshold = 0.0002; // maximum cost
+  const vector<ControlPointP>& points = shape.points;
+  UInt n = (UInt)points.size();
+  if (n == 0) return;
+  vector<UInt> prev(n), next(n);
+  vector<double> cost(n);
+  vector<bool> removed(n, false);
+  for (UInt i = 0 ; i < n ; ++i) {
+    prev[i] = (i + n - 1) % n;
+    next[i] = (i + 1) % n;
+  }
+  // min-heap on (cost, index)
+  typedef pair<double,UInt> Candidate;
+  priority_queue<Candidate, vector<Candidate>, greater<Candidate>> queue;
+  for (UInt i = 0 ; i < n ; ++i) {
+    cost[i] = cost_of_point_removal(*points[prev[i]], *points[i], *points[next[i]]);
+    queue.push(Candidate(cost[i], i));
+  }
+  UInt remaining = n;
+  while (!queue.empty()) {
+    Candidate best = queue.top();
+    queue.pop();
+    UInt i = best.second;
+    if (removed[i] || best.first != cost[i]) continue; // outdated
+    if (best.first > treshold) break;
+    // remove it ...
+    UInt p = prev[i], q = next[i];
+    remove_point(*points[p], *points[i], *points[q]);
+    removed[i] = true;
+    next[p] = q;
+    prev[q] = p;
+    if (--remaining == 0) break;
+    // ... and update the costs of the neighbours
+    cost[p] = cost_of_point_removal(*points[prev[p]], *points[p], *points[next[p]]);
+    queue.push(Candidate(cost[p], p));
+    if (q != p) {
+      cost[q] = cost_of_point_removal(*points[prev[q]], *points[q], *points[next[q]]);
+      queue.push(Candidate(cost[q], q));
+    }
+  }
+  // remove the points from the shape, keeping the order
+  vector<ControlPointP> kept;
+  kept.reserve(remaining);
+  for (UInt i = 0 ; i < n ; ++i) {
+    if (!removed[i]) kept.push_back(points[i]);
+  }
+  shape.points.swap(kept);
+}
 
 void simplify_symbol_shape(SymbolShape& shape) {
   mark_corners(shape);
@@ -470,10 +503,59 @@ void simplify_symbol_shape(SymbolShape& shape) {
   merge_lines(shape);
 }
 
+/// Thread that simplifies shapes from a shared list
+/** The shapes are independent, so they can be simplified in parallel.
+ *  Each shape is claimed by exactly one thread through the shared counter.
+ */
+class SimplifyThread : public wxThread {
+public:
+  SimplifyThread(const vector<SymbolShape*>& shapes, std::atomic<size_t>& next_shape)
+    : wxThread(wxTHREAD_JOINABLE), shapes(shapes), next_shape(next_shape)
+  {}
+  
+  ExitCode Entry() override {
+    run(shapes, next_shape);
+    return 0;
+  }
+  
+  static void run(const vector<SymbolShape*>& shapes, std::atomic<size_t>& next_shape) {
+    for (size_t i = next_shape++ ; i < shapes.size() ; i = next_shape++) {
+      simplify_symbol_shape(*shapes[i]);
+    }
+  }
+  
+private:
+  const vector<SymbolShape*>& shapes;
+  std::atomic<size_t>& next_shape;
+};
+
 void simplify_symbol(Symbol& symbol) {
+  vector<SymbolShape*> shapes;
   FOR_EACH(pb, symbol.parts) {
     if (SymbolShape* p = pb->isSymbolShape()) {
-      simplify_symbol_shape(*p);
+      shapes.push_back(p);
+    }
+  }
+  // biggest shapes first, so the work is spread evenly over the threads
+  stable_sort(shapes.begin(), shapes.end(), [](SymbolShape* a, SymbolShape* b) {
+    return a->points.size() > b->points.size();
+  });
+  std::atomic<size_t> next_shape(0);
+  vector<SimplifyThread*> threads;
+  size_t thread_count = min(shapes.size(), (size_t)max(1, wxThread::GetCPUCount()));
+  for (size_t i = 1 ; i < thread_count ; ++i) {
+    SimplifyThread* thread = new SimplifyThread(shapes, next_shape);
+    if (thread->Run() == wxTHREAD_NO_ERROR) {
+      threads.push_back(thread);
+    } else {
+      delete thread;
+      break;
     }
   }
+  // this thread helps as well
+  SimplifyThread::run(shapes, next_shape);
+  FOR_EACH(thread, threads) {
+    thread->Wait();
+    delete thread;
+  }
 }
@@ -16,6 +16,7 @@
 #include <data/field.hpp>
 #include <data/field/text.hpp>    // for 0.2.7 fix
 #include <data/field/information.hpp>
+#include <data/settings.hpp>
 #include <util/tagged_string.hpp> // for 0.2.7 fix
 #include <util/order_cache.hpp>
 #include <util/delayed_index_maps.hpp>
@@ -28,7 +29,9 @@
 Set::Set()
   : vcs (make_intrusive<VCS>())
   , script_manager(new SetScriptManager(*this))
-{}
+{
+  actions.setMemoryBudget((size_t)settings.undo_memory_budget << 20);
+}
 
 Set::Set(const GameP& game)
   : game(game)
@@ -36,6 +39,7 @@ Set::Set(const GameP& game)
   , script_manager(new SetScriptManager(*this))
 {
   data.init(game->set_fields);
+  actions.setMemoryBudget((size_t)settings.undo_memory_budget << 20);
 }
 
 Set::Set(const StyleSheetP& stylesheet)
@@ -45,6 +49,7 @@ Set::Set(const StyleSheetP& stylesheet)
   , script_manager(new SetScriptManager(*this))
 {
   data.init(game->set_fields);
+  actions.setMemoryBudget((size_t)settings.undo_memory_budget << 20);
 }
 
 Set::~Set() {}
@@ -64,6 +69,9 @@ void Set::updateStyles(const CardP& card, bool only_content_dependent) {
 void Set::updateDelayed() {
   script_manager->updateDelayed();
 }
+void Set::updateAll() {
+  script_manager->updateAll();
+}
 
 Context& Set::getContextForThumbnails() {
   assert(!wxThread::IsMain());
@@ -171,6 +171,7 @@ Settings::Settings()
   , set_window_height    (300)
   , card_notes_height    (40)
   , open_sets_in_new_window(true)
+  , undo_memory_budget   (256)
   , symbol_grid_size     (30)
   , symbol_grid          (true)
   , symbol_grid_snap     (false)
@@ -259,6 +260,7 @@ IMPLEMENT_REFLECTION_NO_SCRIPT(Settings) {
   REFLECT(set_window_height);
   REFLECT(card_notes_height);
   REFLECT(open_sets_in_new_window);
+  REFLECT(undo_memory_budget);
   REFLECT(symbol_grid_size);
   REFLECT(symbol_grid);
   REFLECT(symbol_grid_snap);
@@ -154,6 +154,7 @@ public:
   UInt set_window_height;
   UInt card_notes_height;
   bool open_sets_in_new_window;
+  UInt undo_memory_budget; ///< Memory for the undo history of each set, in MB (0 = unlimited)
   
   // --------------------------------------------------- : Symbol editor
   UInt symbol_grid_size;
@@ -117,6 +117,134 @@ Vector2D Bounds::corner(int dx, int dy) const {
     0.5 * (min.y + max.y + dy * (max.y - min.y)));
 }
 
+// ----------------------------------------------------------------------------- : SegmentIndex
+
+const UInt NO_NODE = (UInt)-1;
+
+Bounds SegmentIndex::build(const vector<ControlPointP>& points) {
+  nodes.clear();
+  leaf_of.assign(points.size(), NO_NODE);
+  point_index.clear();
+  if (points.empty()) return Bounds();
+  nodes.reserve(2 * points.size() - 1);
+  vector<UInt> segments(points.size());
+  vector<Vector2D> centers(points.size());
+  for (UInt i = 0 ; i < points.size() ; ++i) {
+    point_index[points[i].get()] = i;
+    segments[i] = i;
+    centers[i] = (points[i]->pos + points[(i + 1) % points.size()]->pos) * 0.5;
+  }
+  buildNode(segments, centers, 0, segments.size(), NO_NODE);
+  for (UInt i = 0 ; i < points.size() ; ++i) {
+    updateLeaf(points, i);
+  }
+  // fit the internal nodes, children always come after their parent
+  for (size_t n = nodes.size() ; n > 0 ; --n) {
+    Node& node = nodes[n - 1];
+    if (node.right != NO_NODE) {
+      node.box   = nodes[node.left].box;   node.box.update(nodes[node.right].box);
+      node.curve = nodes[node.left].curve; node.curve.update(nodes[node.right].curve);
+    }
+  }
+  return nodes[0].curve;
+}
+
+UInt SegmentIndex::buildNode(vector<UInt>& segments, const vector<Vector2D>& centers, size_t begin, size_t end, UInt parent) {
+  UInt id = (UInt)nodes.size();
+  nodes.push_back(Node{Bounds(), Bounds(), parent, NO_NODE, NO_NODE});
+  if (end - begin == 1) {
+    nodes[id].left = segments[begin];
+    leaf_of[segments[begin]] = id;
+    return id;
+  }
+  // split at the median along the longest axis
+  Bounds extent;
+  for (size_t i = begin ; i < end ; ++i) extent.update(centers[segments[i]]);
+  bool split_x = extent.max.x - extent.min.x >= extent.max.y - extent.min.y;
+  size_t mid = (begin + end) / 2;
+  nth_element(segments.begin() + begin, segments.begin() + mid, segments.begin() + end, [&](UInt a, UInt b) {
+    return split_x ? centers[a].x < centers[b].x : centers[a].y < centers[b].y;
+  });
+  UInt left  = buildNode(segments, centers, begin, mid, id);
+  UInt right = buildNode(segments, centers, mid,   end, id);
+  nodes[id].left  = left;
+  nodes[id].right = right;
+  return id;
+}
+
+void SegmentIndex::updateLeaf(const vector<ControlPointP>& points, UInt segment) {
+  const ControlPoint& p1 = *points[segment];
+  const ControlPoint& p2 = *points[(segment + 1) % points.size()];
+  Node& node = nodes[leaf_of[segment]];
+  node.curve = segment_bounds(Vector2D(), Matrix2D(), p1, p2);
+  node.box = node.curve;
+  node.box.update(p1.pos);
+  node.box.update(p2.pos);
+  node.box.update(p1.pos + p1.delta_after);
+  node.box.update(p2.pos + p2.delta_before);
+}
+
+Bounds SegmentIndex::refit(const vector<ControlPointP>& points, const set<ControlPointP>& moved) {
+  if (!validFor(points.size())) return build(points);
+  UInt n = (UInt)points.size();
+  FOR_EACH_CONST(p, moved) {
+    auto it = point_index.find(p.get());
+    if (it == point_index.end()) return build(points); // not one of our points
+    UInt i = it->second;
+    // the segments before and after the point
+    UInt segs[2] = { (i + n - 1) % n, i };
+    for (UInt s : segs) {
+      updateLeaf(points, s);
+      for (UInt node = nodes[leaf_of[s]].parent ; node != NO_NODE ; node = nodes[node].parent) {
+        Node& nd = nodes[node];
+        nd.box   = nodes[nd.left].box;   nd.box.update(nodes[nd.right].box);
+        nd.curve = nodes[nd.left].curve; nd.curve.update(nodes[nd.right].curve);
+      }
+    }
+  }
+  return nodes[0].curve;
+}
+
+void SegmentIndex::translate(const Vector2D& delta) {
+  FOR_EACH(node, nodes) {
+    node.box.min   += delta; node.box.max   += delta;
+    node.curve.min += delta; node.curve.max += delta;
+  }
+}
+
+template <typename Match>
+void SegmentIndex::findNodes(const Match& match, vector<UInt>& out) const {
+  if (nodes.empty()) return;
+  size_t first = out.size();
+  vector<UInt> stack(1, 0);
+  while (!stack.empty()) {
+    const Node& node = nodes[stack.back()];
+    stack.pop_back();
+    if (!match(node.box)) continue;
+    if (node.right == NO_NODE) {
+      out.push_back(node.left);
+    } else {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+    }
+  }
+  sort(out.begin() + first, out.end());
+}
+
+void SegmentIndex::find(const Vector2D& pos, double range, vector<UInt>& out) const {
+  findNodes([&](const Bounds& b) {
+    return pos.x >= b.min.x - range && pos.x <= b.max.x + range &&
+           pos.y >= b.min.y - range && pos.y <= b.max.y + range;
+  }, out);
+}
+
+void SegmentIndex::findRow(double y, vector<UInt>& out) const {
+  const double epsilon = 1e-9; // intersection tests have some tolerance
+  findNodes([&](const Bounds& b) {
+    return y >= b.min.y - epsilon && y <= b.max.y + epsilon;
+  }, out);
+}
+
 // ----------------------------------------------------------------------------- : SymbolPart
 
 void SymbolPart::updateBounds() {
@@ -212,14 +340,24 @@ void SymbolShape::enforceConstraints() {
 }
 
 Bounds SymbolShape::calculateBounds(const Vector2D& origin, const Matrix2D& m, bool is_identity) {
+  if (is_identity) {
+    return this->bounds = segments.build(points);
+  }
   Bounds bounds;
   for (int i = 0 ; i < (int)points.size() ; ++i) {
     bounds.update(segment_bounds(origin, m, *getPoint(i), *getPoint(i + 1)));
   }
-  if (is_identity) this->bounds = bounds;
   return bounds;
 }
 
+void SymbolShape::updateBounds(const set<ControlPointP>& moved) {
+  if (segments.validFor(points.size())) {
+    bounds = segments.refit(points, moved);
+  } else {
+    updateBounds();
+  }
+}
+
 // ----------------------------------------------------------------------------- : SymbolSymmetry
 
 IMPLEMENT_REFLECTION_ENUM(SymbolSymmetryType) {
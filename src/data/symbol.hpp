@@ -131,6 +131,46 @@ public:
   inline operator RealRect () const { return RealRect(min, RealSize(max - min)); }
 };
 
+// ----------------------------------------------------------------------------- : SegmentIndex
+
+/// Bounding volume hierarchy over the segments of a shape, for finding segments and handles near a position
+/** Segment i goes from point i to point i+1 (wrapping around).
+ *  The box of a segment contains the curve, both end points and the handles of the end points on that side,
+ *  so a point or handle within range of a position is always on a segment that is found.
+ */
+class SegmentIndex {
+public:
+  /// Rebuild the hierarchy for the given points, returns the bounds of the curves
+  Bounds build(const vector<ControlPointP>& points);
+  /// Update the boxes of segments next to points that have moved, returns the bounds of the curves
+  Bounds refit(const vector<ControlPointP>& points, const set<ControlPointP>& moved);
+  /// Move everything by the given amount
+  void translate(const Vector2D& delta);
+  
+  /// Is the index built for a shape with this many points?
+  inline bool validFor(size_t point_count) const { return point_count > 0 && leaf_of.size() == point_count; }
+  
+  /// Find the segments with a box within (manhattan) range of pos, in ascending order
+  void find(const Vector2D& pos, double range, vector<UInt>& out) const;
+  /// Find the segments with a box crossing the horizontal line through y, in ascending order
+  void findRow(double y, vector<UInt>& out) const;
+  
+private:
+  struct Node {
+    Bounds box;    ///< Bounds of segments and handles
+    Bounds curve;  ///< Bounds of just the segments
+    UInt   parent;
+    UInt   left, right; ///< Child nodes; for leaves left is the segment and right is NO_NODE
+  };
+  vector<Node> nodes;  ///< nodes[0] is the root
+  vector<UInt> leaf_of; ///< Leaf node of each segment
+  unordered_map<const ControlPoint*,UInt> point_index; ///< Position of each point in the shape
+  
+  UInt buildNode(vector<UInt>& segments, const vector<Vector2D>& centers, size_t begin, size_t end, UInt parent);
+  void updateLeaf(const vector<ControlPointP>& points, UInt segment);
+  template <typename Match> void findNodes(const Match& match, vector<UInt>& out) const;
+};
+
 // ----------------------------------------------------------------------------- : SymbolPart
 
 /// A part of a symbol, not necesserly a shape
@@ -203,6 +243,8 @@ public:
   SymbolShapeCombine combine;
   // Center of rotation, relative to the part, when the part is scaled to [0..1]
   Vector2D rotation_center;
+  /// Index of the segments, kept up to date together with the bounds
+  SegmentIndex segments;
   
   SymbolShape();
   
@@ -222,6 +264,9 @@ public:
   
   /// Calculate the position and size of the part using the given rotation matrix
   Bounds calculateBounds(const Vector2D& origin, const Matrix2D& m, bool is_identity) override;
+  /// Update the bounds after only the given points have been moved
+  void updateBounds(const set<ControlPointP>& moved);
+  using SymbolPart::updateBounds;
   
   DECLARE_REFLECTION_OVERRIDE();
   void after_reading(Version) override;
@@ -16,6 +16,160 @@
 #include <util/window_id.hpp>
 #include <render/text/element.hpp> // fot CharInfo
 #include <script/image.hpp>
+#include <wx/thread.h>
+
+// ----------------------------------------------------------------------------- : GlyphAtlas
+
+/// Memory budget of the resampled glyphs of a single symbol font
+const size_t GLYPH_ATLAS_BUDGET = 16 * 1024 * 1024;
+/// Memory budget of the glyphs used by other threads than the main thread
+const size_t WORKER_GLYPH_ATLAS_BUDGET = 4 * 1024 * 1024;
+
+/// Cache of resampled symbol images, shared by all symbols in a font
+/** Glyphs are keyed by their size in pixels, so all font sizes and zoom levels that round to the same
+ *  bitmap size share a glyph. The least recently used glyphs are evicted when the budget is exceeded.
+ *  Glyphs are generated without holding the lock.
+ *
+ *  The reference counting of wxImage and wxBitmap is not thread safe. So a font has an atlas for the main thread,
+ *  which hands out the cached glyphs themselves, and an atlas shared by all other threads, which hands out deep copies
+ *  made while holding the lock.
+ */
+class SymbolFont::GlyphAtlas {
+public:
+  GlyphAtlas(size_t budget, bool share_glyphs) : budget(budget), used(0), share_glyphs(share_glyphs) {}
+  
+  struct Key {
+    const SymbolInFont* symbol;
+    int width, height;
+    inline bool operator < (const Key& k) const {
+      return symbol != k.symbol ? symbol < k.symbol : width != k.width ? width < k.width : height < k.height;
+    }
+  };
+  
+  /// Get a glyph image, make is called to generate it if it is not in the atlas
+  template <typename MakeImage>
+  Image getImage(const Key& key, const MakeImage& make) {
+    {
+      wxMutexLocker lock(mutex);
+      Entry* e = find(key);
+      if (e) return handOut(e->image);
+    }
+    Image img = make();
+    wxMutexLocker lock(mutex);
+    Image result = handOut(insert(key, img).image);
+    img = Image(); // the atlas may share this image, release it while holding the lock
+    return result;
+  }
+  /// Get a glyph bitmap, make is called to generate the image if it is not in the atlas
+  template <typename MakeImage>
+  Bitmap getBitmap(const Key& key, const MakeImage& make) {
+    Image img;
+    {
+      wxMutexLocker lock(mutex);
+      Entry* e = find(key);
+      if (e && e->bitmap.Ok()) return handOut(e->bitmap);
+      if (e) img = handOut(e->image);
+    }
+    if (!img.Ok()) img = make();
+    Bitmap bmp(img);
+    wxMutexLocker lock(mutex);
+    Entry& e = insert(key, img);
+    if (!e.bitmap.Ok()) {
+      e.bitmap = bmp;
+      used += e.bytes; // the bitmap takes about as much memory as the image
+      e.bytes *= 2;
+    }
+    Bitmap result = handOut(e.bitmap);
+    // the atlas may share these, release them while holding the lock
+    img = Image();
+    bmp = Bitmap();
+    evict();
+    return result;
+  }
+  
+  /// Remove all glyphs of a symbol
+  void clear(const SymbolInFont* symbol) {
+    wxMutexLocker lock(mutex);
+    for (auto it = entries.lower_bound(Key{symbol, numeric_limits<int>::min(), numeric_limits<int>::min()}) ; it != entries.end() && it->first.symbol == symbol ; ) {
+      used -= it->second.bytes;
+      lru.erase(it->second.lru_pos);
+      it = entries.erase(it);
+    }
+  }
+  
+  /// Lock for data that symbols share with the atlas
+  wxMutex mutex;
+  
+private:
+  struct Entry {
+    Image  image;
+    Bitmap bitmap;
+    size_t bytes;
+    list<Key>::iterator lru_pos;
+  };
+  size_t          budget, used; ///< Memory budget and usage in bytes
+  bool            share_glyphs; ///< Hand out the cached glyphs themselves instead of copies? Only for the main thread
+  map<Key,Entry>  entries;
+  list<Key>       lru;          ///< Keys, most recently used first
+  
+  Image handOut(const Image& img) const {
+    return share_glyphs ? img : img.Copy();
+  }
+  Bitmap handOut(const Bitmap& bmp) const {
+    return share_glyphs ? bmp : bmp.GetSubBitmap(wxRect(0, 0, bmp.GetWidth(), bmp.GetHeight()));
+  }
+  Entry* find(const Key& key) {
+    auto it = entries.find(key);
+    if (it == entries.end()) return nullptr;
+    lru.splice(lru.begin(), lru, it->second.lru_pos);
+    return &it->second;
+  }
+  Entry& insert(const Key& key, const Image& img) {
+    Entry* existing = find(key);
+    if (existing) return *existing; // another thread was first
+    lru.push_front(key);
+    Entry& e = entries[key];
+    e.image   = img;
+    e.bytes   = img.Ok() ? img.GetWidth() * img.GetHeight() * (img.HasAlpha() ? 4 : 3) : 0;
+    e.lru_pos = lru.begin();
+    used += e.bytes;
+    evict();
+    return e;
+  }
+  /// Evict least recently used glyphs, but never the most recent one
+  void evict() {
+    while (used > budget && lru.size() > 1) {
+      auto it = entries.find(lru.back());
+      used -= it->second.bytes;
+      entries.erase(it);
+      lru.pop_back();
+    }
+  }
+};
+
+// ----------------------------------------------------------------------------- : SymbolMatcher
+
+/// Finds symbol codes in text
+/** Literal codes are stored in a trie, so all of them are matched in a single walk over the text.
+ *  Regex symbols are only tried if they come before the best literal match,
+ *  and they are matched anchored at the position instead of searching the rest of the text.
+ *  Like before, the first enabled symbol in the font that matches wins.
+ */
+class SymbolFont::SymbolMatcher {
+public:
+  SymbolMatcher(const vector<SymbolInFontP>& symbols);
+  
+  /// Index of the first enabled symbol that matches text at pos, or symbols.size() if there is none
+  size_t match(const vector<SymbolInFontP>& symbols, const String& text, size_t pos, size_t& length, Regex::Results& results) const;
+  
+private:
+  struct Node {
+    map<Char,UInt> children;
+    vector<UInt>   symbols; ///< Symbols with a code ending here, in order
+  };
+  vector<Node> trie;           ///< Node 0 is the root
+  vector<UInt> regex_symbols;  ///< Symbols that use a regex, in order
+};
 
 // ----------------------------------------------------------------------------- : SymbolFont
 
@@ -28,12 +182,19 @@ SymbolFont::SymbolFont()
   , spacing(1,1)
   , scale_text(false)
   , processed_insert_symbol_menu(nullptr)
+  , atlas(make_unique<GlyphAtlas>(GLYPH_ATLAS_BUDGET, true))
+  , worker_atlas(make_unique<GlyphAtlas>(WORKER_GLYPH_ATLAS_BUDGET, false))
 {}
 
 SymbolFont::~SymbolFont() {
   delete processed_insert_symbol_menu;
 }
 
+void SymbolFont::validate(Version file_app_version) {
+  Packaged::validate(file_app_version);
+  matcher = make_unique<SymbolMatcher>(symbols);
+}
+
 String SymbolFont::typeNameStatic() { return _("symbol-font"); }
 String SymbolFont::typeName() const { return _("symbol-font"); }
 Version SymbolFont::fileVersion() const { return file_version_symbol_font; }
@@ -93,8 +254,20 @@ private:
   ScriptableImage  image;      ///< The image for this symbol
   double           img_size;    ///< Font size used by the image
   wxSize           actual_size;  ///< Actual image size, only known after loading the image
-  /// Cached bitmaps for different sizes
-  map<double, Bitmap> bitmaps;
+  SymbolFont*      font;        ///< The font this symbol is part of, its atlas caches the resampled images
+  Image            source;      ///< The generated image, before resampling (guarded by the atlas mutex)
+  
+  /// Get a copy of the unresampled image, generate it if needed
+  /** Only used when a glyph is not in the atlas, the source is shared by all threads so it is always copied */
+  Image getSource(Package& pkg);
+  /// Size of the unresampled image
+  wxSize sourceSize(Package& pkg);
+  /// Key in the atlas for the given font size
+  SymbolFont::GlyphAtlas::Key glyphKey(Package& pkg, double size);
+  /// The atlas to use on the current thread
+  inline SymbolFont::GlyphAtlas& atlas() const {
+    return wxThread::IsMain() ? *font->atlas : *font->worker_atlas;
+  }
   
   DECLARE_REFLECTION();
 };
@@ -107,34 +280,59 @@ SymbolInFont::SymbolInFont()
   , text_margin_left(0), text_margin_right(0)
   , text_margin_top(0),  text_margin_bottom(0)
   , actual_size(0,0)
+  , font(symbol_font_for_reading())
 {
-  assert(symbol_font_for_reading());
+  assert(font);
   img_size = symbol_font_for_reading()->img_size;
   if (img_size <= 0) img_size = 1;
 }
 
-Image SymbolInFont::getImage(Package& pkg, double size) {
+Image SymbolInFont::getSource(Package& pkg) {
+  {
+    wxMutexLocker lock(font->atlas->mutex);
+    if (source.Ok()) return source.Copy();
+  }
   // generate new image
   if (!image.isReady()) {
     throw Error(_("No image specified for symbol with code '") + code + _("' in symbol font."));
   }
   Image img = image.generate(GeneratedImage::Options(0, 0, &pkg));
+  wxMutexLocker lock(font->atlas->mutex);
+  source = img.Copy(); // don't share with the returned image
   actual_size = wxSize(img.GetWidth(), img.GetHeight());
-  // scale to match expected size
-  Image resampled_image((int) (actual_size.GetWidth()  * size / img_size),
-                        (int) (actual_size.GetHeight() * size / img_size), false);
-  if (!resampled_image.Ok()) return Image(1,1);
-  resample(img, resampled_image);
-  return resampled_image;
+  return img;
 }
-Bitmap SymbolInFont::getBitmap(Package& pkg, double size) {
-  // is this bitmap already loaded/generated?
-  Bitmap& bmp = bitmaps[size];
-  if (!bmp.Ok()) {
-    // generate image, convert to bitmap, store for later use
-    bmp = Bitmap(getImage(pkg, size));
+
+wxSize SymbolInFont::sourceSize(Package& pkg) {
+  {
+    wxMutexLocker lock(font->atlas->mutex);
+    if (actual_size.GetWidth() != 0) return actual_size;
   }
-  return bmp;
+  Image img = getSource(pkg);
+  return wxSize(img.GetWidth(), img.GetHeight());
+}
+
+SymbolFont::GlyphAtlas::Key SymbolInFont::glyphKey(Package& pkg, double size) {
+  wxSize source_size = sourceSize(pkg);
+  return SymbolFont::GlyphAtlas::Key{this,
+    (int) (source_size.GetWidth()  * size / img_size),
+    (int) (source_size.GetHeight() * size / img_size)
+  };
+}
+
+Image SymbolInFont::getImage(Package& pkg, double size) {
+  SymbolFont::GlyphAtlas::Key key = glyphKey(pkg, size);
+  return atlas().getImage(key, [&]() {
+    // scale to match expected size
+    Image resampled_image(key.width, key.height, false);
+    if (!resampled_image.Ok()) return Image(1,1);
+    resample(getSource(pkg), resampled_image);
+    return resampled_image;
+  });
+}
+Bitmap SymbolInFont::getBitmap(Package& pkg, double size) {
+  SymbolFont::GlyphAtlas::Key key = glyphKey(pkg, size);
+  return atlas().getBitmap(key, [&]() { return getImage(pkg, size); });
 }
 Bitmap SymbolInFont::getBitmap(Package& pkg, wxSize size) {
   // generate new bitmap
@@ -145,17 +343,17 @@ Bitmap SymbolInFont::getBitmap(Package& pkg, wxSize size) {
 }
 
 RealSize SymbolInFont::size(Package& pkg, double size) {
-  if (actual_size.GetWidth() == 0) {
-    // we don't know what size the image will be
-    getBitmap(pkg, size);
-  }
-  return wxSize(actual_size * (int) (size) / (int) (img_size));
+  return wxSize(sourceSize(pkg) * (int) (size) / (int) (img_size));
 }
 
 void SymbolInFont::update(Context& ctx) {
   if (image.update(ctx)) {
     // image has changed, cache is no longer valid
-    bitmaps.clear();
+    font->atlas->clear(this);
+    font->worker_atlas->clear(this);
+    wxMutexLocker lock(font->atlas->mutex);
+    source = Image();
+    actual_size = wxSize(0,0);
   }
   enabled.update(ctx);
   if (text_font)
@@ -189,73 +387,104 @@ IMPLEMENT_REFLECTION(SymbolInFont) {
 
 // ----------------------------------------------------------------------------- : SymbolFont : splitting
 
-void SymbolFont::split(const String& text, SplitSymbols& out) const {
-  // read a single symbol until we are done with the text
-  for (size_t pos = 0 ; pos < text.size() ; ) {
-    // check symbol list
-    FOR_EACH_CONST(sym, symbols) {
-      if (!sym->code.empty() && sym->enabled) {
-        if (sym->regex) {
-          if (sym->code_regex.empty()) {
-            sym->code_regex.assign(sym->code);
-          }
-          Regex::Results results;
-          if (sym->code_regex.matches(results,text.begin() + pos, text.end())
-              && results.position() == 0 && results.length() > 0) { //Matches the regex
-            if (sym->draw_text >= 0 && sym->draw_text < (int)results.size()) {
-              out.push_back(DrawableSymbol(
-                      results.str(),
-                      results.str(sym->draw_text),
-                      *sym));
-            } else {
-              out.push_back(DrawableSymbol(
-                      results.str(),
-                      _(""),
-                      *sym));
-            }
-            pos += results.length();
-            goto next_symbol;
-          }
+SymbolFont::SymbolMatcher::SymbolMatcher(const vector<SymbolInFontP>& symbols)
+  : trie(1)
+{
+  for (UInt i = 0 ; i < symbols.size() ; ++i) {
+    SymbolInFont& sym = *symbols[i];
+    if (sym.code.empty()) continue;
+    if (sym.regex) {
+      if (sym.code_regex.empty()) {
+        sym.code_regex.assign(sym.code);
+      }
+      regex_symbols.push_back(i);
+    } else {
+      UInt node = 0;
+      FOR_EACH_CONST(c, sym.code) {
+        auto it = trie[node].children.find(c);
+        if (it == trie[node].children.end()) {
+          trie[node].children.insert(make_pair(c, (UInt)trie.size()));
+          node = (UInt)trie.size();
+          trie.push_back(Node());
         } else {
-          if (is_substr(text, pos, sym->code)) {
-            out.push_back(DrawableSymbol(sym->code, sym->draw_text >= 0 ? sym->code : _(""), *sym));
-            pos += sym->code.size();
-            goto next_symbol; // continue two levels
-          }
+          node = it->second;
         }
       }
+      trie[node].symbols.push_back(i);
     }
-    // unknown code, draw single character as text
-    //out.push_back(DrawableSymbol(text.substr(pos, 1), _(""), defaultSymbol()));
-    pos += 1;
-next_symbol:;
   }
 }
 
-size_t SymbolFont::recognizePrefix(const String& text, size_t start) const {
-  size_t pos;
-  for (pos = start ; pos < text.size() ; ) {
-    // check symbol list
-    FOR_EACH_CONST(sym, symbols) {
-      if (!sym->code.empty() && sym->enabled) {
-        if (sym->regex) {
-          Regex::Results results;
-          if (!sym->code_regex.empty() && sym->code_regex.matches(results,text.begin() + pos, text.end())
-              && results.position() == 0 && results.length() > 0) { //Matches the regex
-            pos += results.length();
-            goto next_symbol;
-          }
-        } else {
-          if (is_substr(text, pos, sym->code)) {
-            pos += sym->code.size();
-            goto next_symbol; // continue two levels
-          }
-        }
+size_t SymbolFont::SymbolMatcher::match(const vector<SymbolInFontP>& symbols, const String& text, size_t pos, size_t& length, Regex::Results& results) const {
+  size_t best = symbols.size();
+  // literal codes, walk the trie as far as the text goes
+  UInt node = 0;
+  for (size_t end = pos ; end < text.size() ; ) {
+    auto it = trie[node].children.find(text[end]);
+    if (it == trie[node].children.end()) break;
+    node = it->second;
+    ++end;
+    FOR_EACH_CONST(i, trie[node].symbols) {
+      if (i >= best) break;
+      if (symbols[i]->enabled) {
+        best = i;
+        length = end - pos;
+        break;
       }
     }
-    // failed
-    break;
-next_symbol:;
+  }
+  // regexes that come before the best literal
+  FOR_EACH_CONST(i, regex_symbols) {
+    if (i >= best) break;
+    const SymbolInFont& sym = *symbols[i];
+    if (sym.enabled && !sym.code_regex.empty()
+        && sym.code_regex.matchesPrefix(results, text.begin() + pos, text.end()) && results.length() > 0) {
+      length = results.length();
+      return i;
+    }
+  }
+  return best;
+}
+
+SymbolInFont* SymbolFont::matchSymbol(const String& text, size_t pos, size_t& length, Regex::Results& results) const {
+  if (!matcher) {
+    // not read from a file
+    const_cast<SymbolFont*>(this)->matcher = make_unique<SymbolMatcher>(symbols);
+  }
+  size_t i = matcher->match(symbols, text, pos, length, results);
+  return i < symbols.size() ? symbols[i].get() : nullptr;
+}
+
+void SymbolFont::split(const String& text, SplitSymbols& out) const {
+  // read a single symbol until we are done with the text
+  Regex::Results results;
+  for (size_t pos = 0 ; pos < text.size() ; ) {
+    size_t length = 0;
+    SymbolInFont* sym = matchSymbol(text, pos, length, results);
+    if (!sym) {
+      // unknown code, skip single character
+      pos += 1;
+    } else if (sym->regex) {
+      if (sym->draw_text >= 0 && sym->draw_text < (int)results.size()) {
+        out.push_back(DrawableSymbol(results.str(), results.str(sym->draw_text), *sym));
+      } else {
+        out.push_back(DrawableSymbol(results.str(), _(""), *sym));
+      }
+      pos += length;
+    } else {
+      out.push_back(DrawableSymbol(sym->code, sym->draw_text >= 0 ? sym->code : _(""), *sym));
+      pos += length;
+    }
+  }
+}
+
+size_t SymbolFont::recognizePrefix(const String& text, size_t start) const {
+  Regex::Results results;
+  size_t pos = start;
+  while (pos < text.size()) {
+    size_t length = 0;
+    if (!matchSymbol(text, pos, length, results)) break;
+    pos += length;
   }
   return pos - start;
 }
@@ -71,6 +71,7 @@ public:
   static String typeNameStatic();
   String typeName() const override;
   Version fileVersion() const override;
+  void validate(Version) override;
   
   /// Generate a 'insert symbol' menu.
   /** This class owns the menu!
@@ -93,6 +94,16 @@ private:
   friend class SymbolInFont;
   friend class InsertSymbolMenu;
   vector<SymbolInFontP> symbols;  ///< The individual symbols
+  
+  class GlyphAtlas;
+  unique_ptr<GlyphAtlas> atlas;   ///< Resampled images of the symbols, for the main thread
+  unique_ptr<GlyphAtlas> worker_atlas; ///< Resampled images of the symbols, for other threads
+  class SymbolMatcher;
+  unique_ptr<SymbolMatcher> matcher; ///< For finding symbol codes in text, built after reading
+  
+  /// Find the first enabled symbol that matches text at pos, or nullptr
+  /** Sets length to the length of the match, and fills results for regex symbols */
+  SymbolInFont* matchSymbol(const String& text, size_t pos, size_t& length, Regex::Results& results) const;
     
   /// Find the default symbol
   /** may return nullptr */
@@ -144,9 +144,14 @@ bool point_in_shape(const Vector2D& pos, const SymbolShape& shape) {
   if (!shape.bounds.contains(pos)) return false;
   
   // Step 2. trace ray outward, count intersections
+  // only segments crossing the row of pos can intersect the ray
   int count = 0;
   size_t size = shape.points.size();
-  for(size_t i = 0 ; i < size ; ++i) {
+  vector<UInt> row;
+  bool use_index = shape.segments.validFor(size);
+  if (use_index) shape.segments.findRow(pos.y, row);
+  for(size_t j = 0 ; j < (use_index ? row.size() : size) ; ++j) {
+    size_t i = use_index ? row[j] : j;
     ControlPointP p1 = shape.getPoint((int) i);
     ControlPointP p2 = shape.getPoint((int) i + 1);
     if (p1->segment_after == SEGMENT_LINE) {
@@ -142,7 +142,8 @@ void set_alpha(Image& img, Byte* alphas, const wxSize& alphas_size);
 void set_alpha(Image& img, double alpha);
 
 /// An alpha mask is an alpha channel that can be copied to another image
-/** It is created by treating black in the source image as transparent and white (red) as opaque
+/** It is created by treating black in the source image as transparent and white (red) as opaque.
+ *  Once loaded a mask is not modified, so it can be shared between threads.
  */
 class AlphaMask : public IntrusivePtrBase<AlphaMask> {
 public:
@@ -152,6 +153,9 @@ public:
   
   /// Load an alpha mask
   void load(const Image& image);
+  /// Load a smaller version of another mask
+  /** The row sizes are derived from those of the source, instead of being determined again. */
+  void loadScaled(const AlphaMask& source, const wxSize& size);
   /// Unload the mask
   void clear();
   
@@ -178,15 +182,19 @@ public:
   
   /// Does this mask have the given size?
   inline bool hasSize(const wxSize& compare_size) const { return size == compare_size; }
+  /// Size of the mask
+  inline const wxSize& getSize() const { return size; }
   /// Is the mask loaded?
   inline bool isLoaded() const { return alpha; }
   
 private:
   wxSize size; ///< Size of the mask
   Byte* alpha; ///< Data of alpha mask
-  mutable int *lefts, *rights; ///< Row sizes
+  int *lefts, *rights; ///< Row sizes
   
+  /// (Re)allocate the arrays for a mask of the given size
+  void allocate(const wxSize& new_size);
   /// Compute lefts and rights from alpha
-  void loadRowSizes() const;
+  void loadRowSizes();
 };
 
@@ -26,23 +26,72 @@ void AlphaMask::clear() {
   delete[] rights; rights = nullptr;
 }
 
-void AlphaMask::load(const Image& img) {
+void AlphaMask::allocate(const wxSize& new_size) {
   size_t old_n = alpha ? size.x * size.y : 0;
-  size.x = img.GetWidth();
-  size.y = img.GetHeight();
-  // Memory
-  size_t n = size.x * size.y;
-  if (n != old_n) {
+  size_t n = new_size.x * new_size.y;
+  if (!alpha || n != old_n) {
     delete[] alpha;
     alpha = new Byte[n];
   }
-  delete[] lefts;  lefts  = nullptr;
-  delete[] rights; rights = nullptr;
+  if (!lefts || size.y != new_size.y) {
+    delete[] lefts;  lefts  = new int[new_size.y];
+    delete[] rights; rights = new int[new_size.y];
+  }
+  size = new_size;
+}
+
+void AlphaMask::load(const Image& img) {
+  allocate(wxSize(img.GetWidth(), img.GetHeight()));
   // Copy red chanel to alpha
+  size_t n = size.x * size.y;
   Byte* from = img.GetData(), *to = alpha;
   for (size_t i = 0 ; i < n ; ++i) {
     to[i] = from[3*i];
   }
+  loadRowSizes();
+}
+
+void AlphaMask::loadScaled(const AlphaMask& source, const wxSize& new_size) {
+  if (!source.alpha || &source == this) return;
+  if (new_size == source.size || new_size.x <= 0 || new_size.y <= 0) {
+    // just a copy
+    allocate(source.size);
+    memcpy(alpha,  source.alpha,  size.x * size.y);
+    memcpy(lefts,  source.lefts,  size.y * sizeof(int));
+    memcpy(rights, source.rights, size.y * sizeof(int));
+    return;
+  }
+  allocate(new_size);
+  // source pixels [x_begin[x], x_begin[x+1]) map to pixel x, at least one of them
+  vector<int> x_begin(size.x + 1), y_begin(size.y + 1);
+  for (int x = 0 ; x <= size.x ; ++x) x_begin[x] = x * source.size.x / size.x;
+  for (int y = 0 ; y <= size.y ; ++y) y_begin[y] = y * source.size.y / size.y;
+  vector<UInt> sums(size.x);
+  for (int y = 0 ; y < size.y ; ++y) {
+    int y0 = y_begin[y], y1 = max(y0 + 1, y_begin[y + 1]);
+    // average of the source pixels in the box
+    fill(sums.begin(), sums.end(), 0);
+    for (int sy = y0 ; sy < y1 ; ++sy) {
+      const Byte* row = source.alpha + sy * source.size.x;
+      for (int x = 0 ; x < size.x ; ++x) {
+        int x1 = max(x_begin[x] + 1, x_begin[x + 1]);
+        for (int sx = x_begin[x] ; sx < x1 ; ++sx) sums[x] += row[sx];
+      }
+    }
+    for (int x = 0 ; x < size.x ; ++x) {
+      UInt count = (y1 - y0) * max(1, x_begin[x + 1] - x_begin[x]);
+      alpha[x + y * size.x] = (Byte)(sums[x] / count);
+    }
+    // row sizes: the union of the source rows
+    int left = size.x, right = 0;
+    for (int sy = y0 ; sy < y1 ; ++sy) {
+      if (source.lefts[sy] > source.rights[sy]) continue; // empty row
+      left  = min(left,  source.lefts[sy]  * size.x / source.size.x);
+      right = max(right, source.rights[sy] * size.x / source.size.x);
+    }
+    lefts[y]  = left;
+    rights[y] = right;
+  }
 }
 
 
@@ -142,10 +191,7 @@ Image AlphaMask::colorImage(const Color& color) const {
 
 // ----------------------------------------------------------------------------- : Contour Mask
 
-void AlphaMask::loadRowSizes() const {
-  if (lefts || !alpha) return;
-  lefts  = new int[size.y];
-  rights = new int[size.y];
+void AlphaMask::loadRowSizes() {
   // for each row: determine left and rightmost white pixel
   for (int y = 0 ; y < size.y ; ++y) {
     lefts[y]  = size.x;
@@ -160,7 +206,6 @@ void AlphaMask::loadRowSizes() const {
 }
 
 double AlphaMask::rowLeft (double y, const RealSize& resize) const {
-  loadRowSizes();
   if (!lefts || y < 0 || y >= resize.height) {
     // no mask, or outside it
     return 0;
@@ -169,7 +214,6 @@ double AlphaMask::rowLeft (double y, const RealSize& resize) const {
 }
 
 double AlphaMask::rowRight(double y, const RealSize& resize) const {
-  loadRowSizes();
   if (!rights || y < 0 || y >= resize.height) {
     // no mask, or outside it
     return resize.width;
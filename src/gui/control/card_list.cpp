@@ -76,6 +76,7 @@ void CardListBase::onAction(const Action& action, bool undone) {
       refreshList();
       FOR_EACH_CONST(s, action.action.steps) focusItem(s.item); // focus all the new cards
     } else {
+      FOR_EACH_CONST(s, action.action.steps) sort_keys.erase(s.item.get());
       long pos = selected_item_pos;
       // adjust focus for all the removed cards
       refreshList();
@@ -103,12 +104,25 @@ void CardListBase::onAction(const Action& action, bool undone) {
     RefreshItem((long)action.card_id1);
     RefreshItem((long)action.card_id2);
   }
-  TYPE_CASE_(action, ScriptValueEvent) {
+  TYPE_CASE(action, ScriptValueEvent) {
     // No refresh needed, a ScriptValueEvent is only generated in response to a ValueAction
+    if (action.card) sort_keys.erase(action.card);
     return;
   }
+  TYPE_CASE(action, ReplaceAllAction) {
+    FOR_EACH_CONST(a, action.actions) {
+      sort_keys.erase(a->card.get());
+    }
+    refreshList(true);
+  }
   TYPE_CASE(action, ValueAction) {
-    if (action.card) refreshList(true);
+    if (action.card) {
+      sort_keys.erase(action.card.get());
+      refreshList(true);
+    } else {
+      // set values can influence the sort scripts of all cards
+      sort_keys.clear();
+    }
   }
 }
 
@@ -124,11 +138,8 @@ void CardListBase::sendEvent(int type) {
 }
 
 void CardListBase::getSelection(vector<CardP>& out) const {
-  long count = GetItemCount();
-  for (long pos = 0 ; pos < count ; ++pos) {
-    if (const_cast<CardListBase*>(this)->IsSelected(pos)) {
-      out.push_back(getCard(pos));
-    }
+  for (long pos = GetFirstSelected() ; pos != -1 ; pos = GetNextSelected(pos)) {
+    out.push_back(getCard(pos));
   }
 }
 
@@ -183,28 +194,71 @@ bool CardListBase::doDelete() {
 
 // ----------------------------------------------------------------------------- : CardListBase : Building the list
 
-// Comparison object for comparing cards
-bool CardListBase::compareItems(void* a, void* b) const {
+const CardListBase::SortKeys& CardListBase::getSortKeys(Card& card) const {
   FieldP sort_field = column_fields[sort_by_column];
-  ValueP va = reinterpret_cast<Card*>(a)->data[sort_field];
-  ValueP vb = reinterpret_cast<Card*>(b)->data[sort_field];
-  assert(va && vb);
-  // compare sort keys
-  int cmp = smart_compare( va->getSortKey(), vb->getSortKey() );
-  if (cmp != 0) return cmp < 0;
-  // equal values, compare alternate sort key
+  if (sort_keys_field != sort_field) {
+    // sorting by a different column, all keys are invalid
+    sort_keys.clear();
+    sort_keys_field = sort_field;
+  }
+  SortKeys& keys = sort_keys[&card];
+  // the keys are still valid if the scripts have not touched the values since we last looked
+  // (user edits are handled in onAction)
+  ValueP value = card.data[sort_field];
+  assert(value);
+  if (!(keys.age == value->last_script_update)) {
+    keys.key = value->getSortKey();
+    keys.age = value->last_script_update;
+  }
   if (alternate_sort_field) {
-    ValueP va = reinterpret_cast<Card*>(a)->data[alternate_sort_field];
-    ValueP vb = reinterpret_cast<Card*>(b)->data[alternate_sort_field];
-    int cmp = smart_compare( va->getSortKey(), vb->getSortKey() );
-    if (cmp != 0) return cmp < 0;
+    ValueP alternate_value = card.data[alternate_sort_field];
+    if (!(keys.alternate_age == alternate_value->last_script_update)) {
+      keys.alternate_key = alternate_value->getSortKey();
+      keys.alternate_age = alternate_value->last_script_update;
+    }
+  }
+  return keys;
+}
+
+// Compare sort keys, the primary key first and then the alternate one
+static int compare_sort_keys(const String& a, const String& alt_a, const String& b, const String& alt_b) {
+  int cmp = a == b ? 0 : smart_compare(a, b);
+  if (cmp != 0) return cmp;
+  return alt_a == alt_b ? 0 : smart_compare(alt_a, alt_b);
+}
+
+// Comparison object for comparing cards
+bool CardListBase::compareItems(void* a, void* b) const {
+  const SortKeys& ka = getSortKeys(*reinterpret_cast<Card*>(a));
+  const SortKeys& kb = getSortKeys(*reinterpret_cast<Card*>(b));
+  return compare_sort_keys(ka.key, ka.alternate_key, kb.key, kb.alternate_key) < 0;
+}
+
+void CardListBase::sortItems(vector<VoidP>& items) {
+  // Look up the keys of each card once, then sort the array of keys.
+  // Only cards that changed since the previous sort need new keys.
+  // Note: references into sort_keys stay valid when new elements are inserted.
+  vector<pair<const SortKeys*,VoidP>> keyed;
+  keyed.reserve(items.size());
+  FOR_EACH(item, items) {
+    keyed.emplace_back(&getSortKeys(*static_cast<Card*>(item.get())), item);
+  }
+  bool ascending = sort_ascending;
+  stable_sort(keyed.begin(), keyed.end(), [ascending](const pair<const SortKeys*,VoidP>& a, const pair<const SortKeys*,VoidP>& b) {
+    const SortKeys& ka = ascending ? *a.first : *b.first;
+    const SortKeys& kb = ascending ? *b.first : *a.first;
+    return compare_sort_keys(ka.key, ka.alternate_key, kb.key, kb.alternate_key) < 0;
+  });
+  for (size_t i = 0 ; i < items.size() ; ++i) {
+    items[i] = keyed[i].second;
   }
-  return false;
 }
 
 void CardListBase::rebuild() {
   ClearAll();
   column_fields.clear();
+  sort_keys.clear();
+  sort_keys_field = FieldP();
   selected_item_pos = -1;
   onRebuild();
   if (!set) return;
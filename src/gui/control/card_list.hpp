@@ -108,6 +108,8 @@ protected:
   void sendEvent(int type = EVENT_CARD_SELECT);
   /// Compare cards
   bool compareItems(void* a, void* b) const override;
+  /// Sort cards by their cached sort keys
+  void sortItems(vector<VoidP>& items) override;
   
   // --------------------------------------------------- : Item 'events'
   
@@ -128,6 +130,17 @@ private:
   
   mutable wxListItemAttr item_attr; // for OnGetItemAttr
   
+  /// The sort keys of a card, as used for the last sort
+  struct SortKeys {
+    Age    age = 0, alternate_age = 0; ///< last_script_update of the values the keys were taken from
+    String key, alternate_key;
+  };
+  mutable unordered_map<const Card*, SortKeys> sort_keys; ///< Cached sort keys, by card
+  mutable FieldP sort_keys_field;                         ///< Field for which the sort_keys were determined
+  
+  /// Get the sort keys of a card, recomputing them only if the card has changed
+  const SortKeys& getSortKeys(Card& card) const;
+  
 public:
   /// Open a dialog for selecting columns to be shown
   void selectColumns();
@@ -33,6 +33,8 @@ public:
   void redraw();
   /// Invalidate and redraw (the area of) a single value viewer
   void redraw(const ValueViewer&) override;
+  /// Images are decoded in the background, so switching cards stays responsive
+  bool loadImagesInBackground() const override { return true; }
   
   /// The rotation to use
   Rotation getRotation() const override;
@@ -160,41 +160,91 @@ GraphData::GraphData(const GraphDataPre& d)
     }
     ++i;
   }
-  // count elements in each position
-  values.reserve(d.elements.size());
-  size_t de_size = sizeof(GraphDataElement) + sizeof(int) * (axes.size() - 1);
+  // group number of each element on each axis
+  original_indices.reserve(d.elements.size());
   FOR_EACH_CONST(e, d.elements) {
-    // make the group_nrs large enough
-    GraphDataElement* de = reinterpret_cast<GraphDataElement*>(new char[de_size]);
-    de->original_index = e->original_index;
-    // find index j in elements
-    int i = 0;
-    FOR_EACH(a, axes) {
-      String v = e->values[i];
-      de->group_nrs[i] = -1;
+    original_indices.push_back(e->original_index);
+  }
+  group_nrs.resize(axes.size());
+  i = 0;
+  FOR_EACH(a, axes) {
+    // find group by name, the first group with a name wins
+    map<String,int> group_by_name;
+    int j = 0;
+    FOR_EACH(g, a->groups) {
+      group_by_name.insert(make_pair(g.name, j++));
+    }
+    vector<int>& column = group_nrs[i];
+    column.reserve(d.elements.size());
+    FOR_EACH_CONST(e, d.elements) {
+      const String& v = e->values[i];
       double d;
       if (a->numeric && a->bin_size > 0 && v.ToDouble(&d)) {
         // calculate group that contains v
-        de->group_nrs[i] = bin_to_group(d, a->bin_size);
+        column.push_back(bin_to_group(d, a->bin_size));
       } else {
-        // find group that contains v
-        int j = 0;
-        FOR_EACH(g, a->groups) {
-          if (v == g.name) {
-            de->group_nrs[i] = j;
-            break;
-          }
-          ++j;
-        }
+        auto it = group_by_name.find(v);
+        column.push_back(it == group_by_name.end() ? -1 : it->second);
       }
-      ++i;
     }
-    values.push_back(de);
+    ++i;
+  }
+  buildCube();
+}
+
+/// Maximum number of cells in the cube, larger data is scanned instead
+const size_t MAX_CUBE_CELLS = 1 << 20;
+
+void GraphData::buildCube() {
+  // size of the cube, bins can fall outside the groups
+  size_t cells = 1;
+  cube_dims.resize(axes.size());
+  for (size_t a = 0 ; a < axes.size() ; ++a) {
+    int max_group = (int)axes[a]->groups.size() - 1;
+    FOR_EACH_CONST(g, group_nrs[a]) max_group = max(max_group, g);
+    cube_dims[a] = max_group + 1;
+    cells *= max(cube_dims[a], (size_t)1);
+    if (cells > MAX_CUBE_CELLS) {
+      cube_dims.clear();
+      return;
+    }
+  }
+  // counting sort of elements by cell
+  vector<size_t> element_cell(size(), (size_t)-1);
+  cell_start.assign(cells + 1, 0);
+  cell_counts.assign(cells, 0);
+  vector<int> match(axes.size());
+  for (size_t i = 0 ; i < size() ; ++i) {
+    for (size_t a = 0 ; a < axes.size() ; ++a) match[a] = group_nrs[a][i];
+    size_t c = cellOf(match);
+    if (c == (size_t)-1) continue;
+    element_cell[i] = c;
+    cell_start[c + 1]++;
+  }
+  for (size_t c = 0 ; c < cells ; ++c) {
+    cell_start[c + 1] += cell_start[c];
+  }
+  cell_elements.resize(cell_start[cells]);
+  vector<UInt> pos(cell_start.begin(), cell_start.end() - 1);
+  vector<size_t> prev_index(cells, (size_t)-1);
+  for (size_t i = 0 ; i < size() ; ++i) {
+    size_t c = element_cell[i];
+    if (c == (size_t)-1) continue;
+    cell_elements[pos[c]++] = (UInt)i;
+    if (original_indices[i] != prev_index[c]) {
+      prev_index[c] = original_indices[i]; // don't count the same index twice
+      cell_counts[c]++;
+    }
   }
 }
 
-GraphData::~GraphData() {
-  FOR_EACH_CONST(v,values) delete v;
+size_t GraphData::cellOf(const vector<int>& match) const {
+  size_t c = 0;
+  for (size_t a = 0 ; a < match.size() ; ++a) {
+    if (match[a] < 0 || (size_t)match[a] >= cube_dims[a]) return (size_t)-1;
+    c = c * cube_dims[a] + match[a];
+  }
+  return c;
 }
 
 void GraphData::crossAxis(size_t axis1, size_t axis2, vector<UInt>& out) const {
@@ -202,9 +252,11 @@ void GraphData::crossAxis(size_t axis1, size_t axis2, vector<UInt>& out) const {
   size_t a2_size = axes[axis2]->groups.size();
   out.clear();
   out.resize(a1_size * a2_size, 0);
-  FOR_EACH_CONST(v, values) {
-    int v1 = v->group_nrs[axis1], v2 = v->group_nrs[axis2];
-    if (v1 >= 0 && v2 >= 0) {
+  const vector<int>& g1 = group_nrs[axis1];
+  const vector<int>& g2 = group_nrs[axis2];
+  for (size_t i = 0 ; i < size() ; ++i) {
+    int v1 = g1[i], v2 = g2[i];
+    if (v1 >= 0 && v2 >= 0 && (size_t)v1 < a1_size && (size_t)v2 < a2_size) {
       out[a2_size * v1 + v2]++;
     }
   }
@@ -216,45 +268,83 @@ void GraphData::crossAxis(size_t axis1, size_t axis2, size_t axis3, vector<UInt>
   size_t a3_size = axes[axis3]->groups.size();
   out.clear();
   out.resize(a1_size * a2_size * a3_size, 0);
-  FOR_EACH_CONST(v, values) {
-    int v1 = v->group_nrs[axis1], v2 = v->group_nrs[axis2], v3 = v->group_nrs[axis3];
-    if (v1 >= 0 && v2 >= 0 && v3 >= 0) {
+  const vector<int>& g1 = group_nrs[axis1];
+  const vector<int>& g2 = group_nrs[axis2];
+  const vector<int>& g3 = group_nrs[axis3];
+  for (size_t i = 0 ; i < size() ; ++i) {
+    int v1 = g1[i], v2 = g2[i], v3 = g3[i];
+    if (v1 >= 0 && v2 >= 0 && v3 >= 0 && (size_t)v1 < a1_size && (size_t)v2 < a2_size && (size_t)v3 < a3_size) {
       out[a3_size * (a2_size * v1 + v2) + v3]++;
     }
   }
 }
 
-bool matches(const GraphDataElement* v, const vector<int>& match) {
-  for (size_t i = 0 ; i < match.size() ; ++i) {
-    if (v->group_nrs[i] == -1 || (match[i] != -1 && v->group_nrs[i] != match[i])) {
+bool GraphData::matches(size_t i, const vector<int>& match) const {
+  for (size_t a = 0 ; a < match.size() ; ++a) {
+    int g = group_nrs[a][i];
+    if (g == -1 || (match[a] != -1 && g != match[a])) {
       return false;
     }
   }
   return true;
 }
 
+const vector<size_t>& GraphData::select(const vector<int>& match) const {
+  auto it = selection_cache.find(match);
+  if (it != selection_cache.end()) return it->second;
+  vector<size_t>& out = selection_cache[match];
+  // how many cells would we have to visit?
+  size_t cells = cube_dims.empty() ? size() + 1 : 1;
+  for (size_t a = 0 ; a < match.size() && !cube_dims.empty() ; ++a) {
+    if (match[a] == -1) cells *= cube_dims[a];
+  }
+  if (cells <= size()) {
+    // visit all cells matching the wildcards, like an odometer over the wildcard axes
+    vector<size_t> wildcards;
+    vector<int> cell_match = match;
+    for (size_t a = 0 ; a < match.size() ; ++a) {
+      if (match[a] == -1) {
+        wildcards.push_back(a);
+        cell_match[a] = 0;
+      }
+    }
+    while (true) {
+      size_t c = cellOf(cell_match);
+      if (c != (size_t)-1) {
+        for (UInt e = cell_start[c] ; e < cell_start[c + 1] ; ++e) {
+          out.push_back(original_indices[cell_elements[e]]);
+        }
+      }
+      size_t k = wildcards.size();
+      while (k > 0 && (size_t)++cell_match[wildcards[k-1]] >= cube_dims[wildcards[k-1]]) {
+        cell_match[wildcards[k-1]] = 0;
+        --k;
+      }
+      if (k == 0) break;
+    }
+    sort(out.begin(), out.end());
+  } else {
+    for (size_t i = 0 ; i < size() ; ++i) {
+      if (matches(i, match)) out.push_back(original_indices[i]);
+    }
+  }
+  out.erase(unique(out.begin(), out.end()), out.end()); // don't select the same index twice
+  return out;
+}
+
 UInt GraphData::count(const vector<int>& match) const {
   if (match.size() != axes.size()) return 0;
-  UInt count = 0;
-  size_t prev_index = (size_t)-1;
-  FOR_EACH_CONST(v, values) {
-    if (matches(v, match) && v->original_index != prev_index) {
-      prev_index = v->original_index; // don't count the same index twice
-      count += matches(v, match);
-    }
+  if (!cube_dims.empty() && find(match.begin(), match.end(), -1) == match.end()) {
+    size_t c = cellOf(match);
+    return c == (size_t)-1 ? 0 : cell_counts[c];
   }
-  return count;
+  return (UInt)select(match).size();
 }
 
 void GraphData::indices(const vector<int>& match, vector<size_t>& out) const {
   if (match.size() != axes.size()) return;
-  size_t prev_index = (size_t)-1;
-  FOR_EACH_CONST(v, values) {
-    if (matches(v, match) && v->original_index != prev_index) {
-      prev_index = v->original_index; // don't select the same index twice
-      out.push_back(v->original_index);
-    }
-  }
+  const vector<size_t>& selected = select(match);
+  out.insert(out.end(), selected.begin(), selected.end());
 }
 
 // ----------------------------------------------------------------------------- : Graph1D
@@ -100,21 +100,23 @@ public:
   void splitList(size_t axis);
 };
 
-/// A single data point of a graph
-struct GraphDataElement {
-  size_t original_index;
-  int    group_nrs[1];   ///< Group number for each axis
-};
-
 /// Data to be displayed in a graph
+/** The elements are stored column wise: element i came from original_indices[i],
+ *  and has group group_nrs[axis][i] on each axis (or -1).
+ *
+ *  The elements are also bucketed into a cube with a cell for each combination of groups,
+ *  so counting and selecting a bar/slice/cell doesn't need to look at all elements.
+ */
 class GraphData : public IntrusivePtrBase<GraphData> {
 public:
   GraphData(const GraphDataPre&);
-  ~GraphData();
   
-  vector<GraphAxisP>        axes;    ///< The axes in the data
-  vector<GraphDataElement*> values;  ///< All elements, with the group number for each axis, or -1
-  UInt                      size;    ///< Total number of elements
+  vector<GraphAxisP>  axes;             ///< The axes in the data
+  vector<size_t>      original_indices; ///< For each element, the index in the original input (sorted)
+  vector<vector<int>> group_nrs;        ///< For each axis, the group number of each element, or -1
+  
+  /// Number of elements
+  inline size_t size() const { return original_indices.size(); }
   
   /// Create a cross table for two axes
   void crossAxis(size_t axis1, size_t axis2, vector<UInt>& out) const;
@@ -124,6 +126,23 @@ public:
   UInt count(const vector<int>& match) const;
   /// Get the original_indices of elements matching the selection
   void indices(const vector<int>& match, vector<size_t>& out) const;
+  
+private:
+  // The cube, only built if it is not too large
+  vector<size_t> cube_dims;     ///< Number of cells along each axis
+  vector<UInt>   cell_start;    ///< Elements of cell c are cell_elements[cell_start[c]..cell_start[c+1]]
+  vector<UInt>   cell_elements; ///< Element numbers, grouped by cell, in order
+  vector<UInt>   cell_counts;   ///< Number of distinct original indices in each cell
+  /// Results of earlier wildcard queries
+  mutable map<vector<int>,vector<size_t>> selection_cache;
+  
+  void buildCube();
+  /// Cell number of a match without wildcards, or -1 if it is outside the cube
+  size_t cellOf(const vector<int>& match) const;
+  /// Does element i match?
+  bool matches(size_t i, const vector<int>& match) const;
+  /// Original indices of all matching elements, sorted and without duplicates
+  const vector<size_t>& select(const vector<int>& match) const;
 };
 
 
@@ -124,9 +124,11 @@ void ItemList::focusSelectedItem(bool force_focus) {
   }
 }
 void ItemList::focusNone() {
-  long count = GetItemCount();
-  for (long pos = 0 ; pos < count ; ++pos) {
+  // only visit the focused items, not the entire list
+  long pos = GetFirstSelected();
+  while (pos != -1) {
     Select(pos, false);
+    pos = GetNextSelected(pos);
   }
 }
 void ItemList::focusItem(const VoidP& item, bool focus) {
@@ -139,12 +141,7 @@ void ItemList::focusItem(const VoidP& item, bool focus) {
   }
 }
 long ItemList::focusCount() const {
-  long count = GetItemCount();
-  long focused = 0;
-  for (long pos = 0 ; pos < count ; ++pos) {
-    if (const_cast<ItemList*>(this)->IsSelected(pos)) focused++;
-  }
-  return focused;
+  return GetSelectedItemCount();
 }
 
 // ----------------------------------------------------------------------------- : ItemList : Building the list
@@ -163,6 +160,10 @@ struct ItemList::ItemComparer {
   }
 };
 
+void ItemList::sortItems(vector<VoidP>& items) {
+  stable_sort(items.begin(), items.end(), ItemComparer(*this));
+}
+
 void ItemList::refreshList(bool refresh_current_only) {
   // Get all items
   vector<VoidP> old_sorted_list;
@@ -170,7 +171,7 @@ void ItemList::refreshList(bool refresh_current_only) {
   getItems(sorted_list);
   // Sort the list
   if (sort_by_column >= 0) {
-    stable_sort(sorted_list.begin(), sorted_list.end(), ItemComparer(*this));
+    sortItems(sorted_list);
   }
   // Has the entire list changed?
   if (refresh_current_only && sorted_list == old_sorted_list) {
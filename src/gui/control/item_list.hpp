@@ -42,6 +42,10 @@ public:
   void selectFirst();
   /// Select all items
   void doSelectAll();
+  /// Position of the selected item in the sorted list, or -1 if nothing is selected
+  inline long getSelectedPos() const { return selected_item_pos; }
+  /// Number of items in the sorted list
+  inline long getItemCount() const { return (long)sorted_list.size(); }
   
   // --------------------------------------------------- : Clipboard
   
@@ -67,6 +71,9 @@ protected:
   virtual bool mustSort() const { return false; }
   /// Compare two items for < based on sort_by_column (not on sort_ascending)
   virtual bool compareItems(void* a, void* b) const = 0;
+  /// Sort a list of items by sort_by_column and sort_ascending
+  /** By default uses compareItems, derived classes can sort in a smarter way. */
+  virtual void sortItems(vector<VoidP>& items);
   
   // --------------------------------------------------- : Protected interface
   /// Return the card at the given position in the sorted list
@@ -8,6 +8,8 @@
 
 #include <util/prec.hpp>
 #include <script/profiler.hpp>
+#include <util/window_id.hpp>
+#include <util/error.hpp>
 #include <wx/dcbuffer.h>
 
 #if USE_SCRIPT_PROFILING
@@ -102,16 +104,18 @@ void ProfilerPanel::draw_profiler(wxDC& dc, int x0, int y0) {
     // set up positions/sizes
     int line_height = dc.GetCharHeight() + 2;
     int x1 = dc.GetSize().x - 2;
-    int pos[] = {x0+2, x1-124, x1-84, x1-44, x1-4 };
+    int pos[] = {x0+2, x1-234, x1-184, x1-124, x1-84, x1-44, x1-4 };
     // fancy effects
     bool any_active = false;
     long now = stopwatch.Time();
     // Draw table
     dc.DrawText(_("Function"), pos[0], y0 + 2);
     draw_right(dc,_("calls"),  pos[1], y0 + 2);
-    draw_right(dc,_("avg"),    pos[2], y0 + 2);
-    draw_right(dc,_("total"),  pos[3], y0 + 2);
-    draw_right(dc,_("max"),    pos[4], y0 + 2);
+    draw_right(dc,_("memo"),   pos[2], y0 + 2);
+    draw_right(dc,_("allocs"), pos[3], y0 + 2);
+    draw_right(dc,_("avg"),    pos[4], y0 + 2);
+    draw_right(dc,_("total"),  pos[5], y0 + 2);
+    draw_right(dc,_("max"),    pos[6], y0 + 2);
     dc.DrawLine(x0, y0 + line_height + 2, x1, y0 + line_height + 2);
     int i = 0;
     FOR_EACH_REVERSE(prof, profiles) {
@@ -136,10 +140,12 @@ void ProfilerPanel::draw_profiler(wxDC& dc, int x0, int y0) {
       // draw line
       int y = y0 + (++i) * line_height + 6;
       dc.DrawText(prof->name,                                        pos[0], y);
-      draw_right(dc,wxString::Format(_("%d"),   prof->calls),        pos[1], y);
-      draw_right(dc,wxString::Format(_("%.2f"), prof->avg_time()),   pos[2], y);
-      draw_right(dc,wxString::Format(_("%.2f"), prof->total_time()), pos[3], y);
-      draw_right(dc,wxString::Format(_("%.2f"), prof->max_time()),   pos[4], y);
+      draw_right(dc,wxString::Format(_("%d"),   prof->calls),             pos[1], y);
+      draw_right(dc,wxString::Format(_("%d"),   prof->memo_hits),         pos[2], y);
+      draw_right(dc,wxString::Format(_("%.1f"), prof->avg_allocations()), pos[3], y);
+      draw_right(dc,wxString::Format(_("%.2f"), prof->avg_time()),        pos[4], y);
+      draw_right(dc,wxString::Format(_("%.2f"), prof->total_time()),      pos[5], y);
+      draw_right(dc,wxString::Format(_("%.2f"), prof->max_time()),        pos[6], y);
     }
     // are any fancy effects active?
     if (fancy_effects && any_active && !timer.IsRunning()) {
@@ -168,13 +174,71 @@ BEGIN_EVENT_TABLE(ProfilerPanel, wxPanel)
 END_EVENT_TABLE()
 
 
+// -----------------------------------------------------------------------------
+// Profiler Window
+// -----------------------------------------------------------------------------
+
+class ProfilerWindow : public wxDialog {
+public:
+  ProfilerWindow(wxWindow* parent);
+  
+private:
+  wxCheckBox* enabled;
+  wxButton*   trace;
+  
+  DECLARE_EVENT_TABLE();
+  void onEnable(wxCommandEvent&);
+  void onTrace(wxCommandEvent&);
+};
+
+ProfilerWindow::ProfilerWindow(wxWindow* parent)
+  : wxDialog(parent, wxID_ANY, _("Profiler"), wxDefaultPosition,wxSize(500,600), wxDEFAULT_DIALOG_STYLE|wxRESIZE_BORDER)
+{
+  // init controls
+  enabled = new wxCheckBox(this, ID_PROFILER_ENABLE, _("Enable profiling"));
+  trace   = new wxButton(this, ID_PROFILER_TRACE, profile_tracing() ? _("Save trace...") : _("Record trace"));
+  enabled->SetValue(profiling_enabled());
+  // init sizer
+  wxSizer* s = new wxBoxSizer(wxVERTICAL);
+  s->Add(new ProfilerPanel(this,true), 1, wxEXPAND | wxALL, 8);
+  wxSizer* s2 = new wxBoxSizer(wxHORIZONTAL);
+    s2->Add(enabled, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 8);
+    s2->Add(trace,   0, wxALIGN_CENTER_VERTICAL);
+  s->Add(s2, 0, wxLEFT | wxRIGHT, 8);
+  s->Add(CreateButtonSizer(wxOK), 0, wxALIGN_CENTER | wxALL, 8);
+  SetSizer(s);
+}
+
+void ProfilerWindow::onEnable(wxCommandEvent& ev) {
+  set_profiling_enabled(ev.IsChecked());
+}
+
+void ProfilerWindow::onTrace(wxCommandEvent&) {
+  if (!profile_tracing()) {
+    profile_trace_start();
+    enabled->SetValue(true);
+    trace->SetLabel(_("Save trace..."));
+  } else {
+    profile_trace_stop();
+    trace->SetLabel(_("Record trace"));
+    String name = wxFileSelector(_("Save trace"), wxEmptyString, _("trace.json"), _("json"), _("Chrome trace files (*.json)|*.json"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT, this);
+    if (name.empty()) return;
+    try {
+      profile_trace_write(name);
+    } catch (const Error& e) {
+      handle_error(e);
+    }
+  }
+}
+
+BEGIN_EVENT_TABLE(ProfilerWindow, wxDialog)
+  EVT_CHECKBOX(ID_PROFILER_ENABLE, ProfilerWindow::onEnable)
+  EVT_BUTTON  (ID_PROFILER_TRACE,  ProfilerWindow::onTrace)
+END_EVENT_TABLE()
+
+
 void show_profiler_window(wxWindow* parent) {
-  wxDialog* dlg = new wxDialog(parent, wxID_ANY, _("Profiler"), wxDefaultPosition,wxSize(450,600), wxDEFAULT_DIALOG_STYLE|wxRESIZE_BORDER);
-  wxSizer* sizer = new wxBoxSizer(wxVERTICAL);
-  sizer->Add(new ProfilerPanel(dlg,true), 1, wxEXPAND | wxALL, 8);
-  sizer->Add(dlg->CreateButtonSizer(wxOK), 0, wxALIGN_CENTER | wxALL, 8);
-  dlg->SetSizer(sizer);
-  dlg->Show();
+  (new ProfilerWindow(parent))->Show();
 }
 
 #endif
@@ -20,7 +20,11 @@
 #include <data/card.hpp>
 #include <data/add_cards_script.hpp>
 #include <data/action/set.hpp>
+#include <data/action/value.hpp>
 #include <data/settings.hpp>
+#include <data/field/image.hpp>
+#include <data/field/text.hpp>
+#include <render/value/image_cache.hpp>
 #include <util/find_replace.hpp>
 #include <util/tagged_string.hpp>
 #include <util/window_id.hpp>
@@ -30,6 +34,7 @@
 
 CardsPanel::CardsPanel(Window* parent, int id)
   : SetWindowPanel(parent, id)
+  , prefetch_next(0)
 {
   // init controls
   editor      = new CardEditor(this, ID_EDITOR);
@@ -143,6 +148,9 @@ CardsPanel::~CardsPanel() {
 }
 
 void CardsPanel::onChangeSet() {
+  prefetched_around = CardP();
+  prefetch_queue.clear();
+  prefetch_next = 0;
   editor->setSet(set);
   notes->setSet(set);
   card_list->setSet(set);
@@ -447,6 +455,15 @@ private:
   CardsPanel& panel;
 };
 
+class CardsPanel::ReplaceAllFindInfo : public FindInfo {
+public:
+  ReplaceAllFindInfo(wxFindReplaceData& what) : FindInfo(what) {}
+  bool handle(const CardP& card, const TextValueP& value, size_t pos, bool was_selection) override {
+    return false; // not used, values are replaced with replaceAll
+  }
+  bool select() const override { return false; }
+};
+
 bool CardsPanel::doFind(wxFindReplaceData& what) {
   SearchFindInfo find(*this, what);
   return search(find, false);
@@ -456,7 +473,23 @@ bool CardsPanel::doReplace(wxFindReplaceData& what) {
   return search(find, false);
 }
 bool CardsPanel::doReplaceAll(wxFindReplaceData& what) {
-  return false; // TODO
+  ReplaceAllFindInfo find(what);
+  // replace in all editable text values of all cards, as a single action
+  auto action = make_unique<ReplaceAllAction>(_("Replace all"));
+  FOR_EACH(card, set->cards) {
+    FOR_EACH(v, card->data) {
+      TextValueP value = dynamic_pointer_cast<TextValue>(v);
+      if (!value || !value->fieldP->editable) continue;
+      String new_value = find.replaceAll(value->value());
+      if (new_value == value->value()) continue;
+      auto replace = make_unique<TextValueAction>(value, 0, 0, 0, new_value, _("Replace all"));
+      replace->setCard(card);
+      action->actions.push_back(move(replace));
+    }
+  }
+  if (action->actions.empty()) return false;
+  set->actions.addAction(move(action), false);
+  return true;
 }
 
 bool CardsPanel::search(FindInfo& find, bool from_start) {
@@ -497,4 +530,51 @@ void CardsPanel::selectFirstCard() {
 
 void CardsPanel::getCardLists(vector<CardListBase*>& out) {
   out.push_back(card_list);
-}
+}
+
+// ----------------------------------------------------------------------------- : Prefetching
+
+/// How many cards before and after the selected card to prefetch
+const long PREFETCH_DISTANCE = 3;
+
+void CardsPanel::onIdle(wxIdleEvent& ev) {
+  ev.Skip();
+  if (!set || !IsShownOnScreen()) return;
+  CardP card = card_list->getCard();
+  if (!card) return;
+  if (card != prefetched_around) {
+    prefetched_around = card;
+    prefetchNeighbours();
+  }
+  // the file is read on this thread, so read one file per idle event to keep the ui responsive
+  if (prefetch_next >= prefetch_queue.size()) return;
+  try {
+    decoded_image_cache.prefetch(*set, prefetch_queue[prefetch_next++]);
+  } catch (const Error&) {
+    // ignore errors, they will be reported when the card is shown
+  }
+  if (prefetch_next < prefetch_queue.size()) ev.RequestMore();
+}
+
+void CardsPanel::prefetchNeighbours() {
+  prefetch_queue.clear();
+  prefetch_next = 0;
+  long pos = card_list->getSelectedPos();
+  if (pos < 0) return;
+  // the next cards first, that is the usual direction for paging through a set
+  for (long d = 1 ; d <= PREFETCH_DISTANCE ; ++d) {
+    for (long p : {pos + d, pos - d}) {
+      if (p < 0 || p >= card_list->getItemCount()) continue;
+      CardP card = card_list->getCard(p);
+      FOR_EACH(v, card->data) {
+        ImageValue* image = dynamic_cast<ImageValue*>(v.get());
+        if (!image || image->filename.empty()) continue;
+        prefetch_queue.push_back(image->filename.toStringForKey());
+      }
+    }
+  }
+}
+
+BEGIN_EVENT_TABLE(CardsPanel, SetWindowPanel)
+  EVT_IDLE     (CardsPanel::onIdle)
+END_EVENT_TABLE  ()
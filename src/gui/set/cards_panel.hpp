@@ -66,6 +66,7 @@ private:
   bool search(FindInfo& find, bool from_start);
   class SearchFindInfo;
   class ReplaceFindInfo;
+  class ReplaceAllFindInfo;
   friend class CardsPanel::SearchFindInfo;
   friend class CardsPanel::ReplaceFindInfo;
 public:
@@ -78,6 +79,20 @@ public:
   void getCardLists(vector<CardListBase*>& out) override;
 
 private:
+  // --------------------------------------------------- : Prefetching
+  CardP prefetched_around;       ///< Card around which we last prefetched
+  vector<String> prefetch_queue; ///< Images still to prefetch around that card
+  size_t prefetch_next;          ///< Position in prefetch_queue
+  
+  DECLARE_EVENT_TABLE();
+  void onIdle(wxIdleEvent&);
+  /// Find the card art of the cards around the selected one, in list order
+  /** Only the art is prefetched. Style scripts and text layout live in shared, non thread safe objects,
+   *  evaluating them ahead of time would be redone for the shown card anyway.
+   */
+  void prefetchNeighbours();
+  
+
   // --------------------------------------------------- : Controls
   wxSizer*          s_left;
   wxSplitterWindow* splitter;
@@ -88,6 +88,9 @@ void SymbolControl::onExtraTool(wxCommandEvent& ev) {
 }
 
 void SymbolControl::onAction(const Action& action, bool undone) {
+  // keep bounds and segment indices up to date for hit testing,
+  // editors update them themselves while extending an action
+  symbol->updateBounds();
   TYPE_CASE_(action, SymbolPartAction) {
     Refresh(false);
   }
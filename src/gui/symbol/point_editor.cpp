@@ -291,6 +291,7 @@ void SymbolPointEditor::onMouseDrag(const Vector2D& from, const Vector2D& to, wx
       addAction(std::move(action));
     }
     curveDragAction->move(delta, selected_line_t);
+    part->updateBounds({selected_line1, selected_line2});
     control.Refresh(false);
   } else if (selection == SELECTED_POINTS || selection == SELECTED_LINE) {
     // Move all selected points
@@ -304,6 +305,7 @@ void SymbolPointEditor::onMouseDrag(const Vector2D& from, const Vector2D& to, wx
     controlPointMoveAction->constrain = ev.ControlDown(); // ctrl constrains
     controlPointMoveAction->snap      = snap(ev);
     controlPointMoveAction->move(delta);
+    part->updateBounds(selected_points);
     new_point += delta;
     control.Refresh(false);
   } else if (selection == SELECTED_HANDLE) {
@@ -316,6 +318,7 @@ void SymbolPointEditor::onMouseDrag(const Vector2D& from, const Vector2D& to, wx
     handleMoveAction->constrain  = ev.ControlDown(); // ctrl constrains
     handleMoveAction->snap = snap(ev);
     handleMoveAction->move(delta);
+    part->updateBounds({selected_handle.point});
     control.Refresh(false);
   }
 }
@@ -341,11 +344,13 @@ void SymbolPointEditor::onKeyChange(wxKeyEvent& ev) {
       controlPointMoveAction->constrain = ev.ControlDown();
       controlPointMoveAction->snap = snap(ev);
       controlPointMoveAction->move(Vector2D()); //refresh action
+      part->updateBounds(selected_points);
       control.Refresh(false);
     } else if (handleMoveAction) {
       handleMoveAction->constrain = ev.ControlDown();
       handleMoveAction->snap = snap(ev);
       handleMoveAction->move(Vector2D()); //refresh action
+      part->updateBounds({selected_handle.point});
       control.Refresh(false);
     }
   }
@@ -521,8 +526,10 @@ void SymbolPointEditor::findHoveredItem(const Vector2D& pos, bool altDown) {
 
 bool SymbolPointEditor::checkPosOnCurve(const Vector2D& pos) {
   double range = control.rotation.trInvS(3); // less then 3 pixels away is still a hit
-  size_t size = part->points.size();
-  for(int i = 0 ; (size_t)i < size ; ++i) {
+  if (!part->segments.validFor(part->points.size())) part->updateBounds();
+  vector<UInt> near_segments;
+  part->segments.find(pos, range, near_segments);
+  FOR_EACH_CONST(i, near_segments) {
     // Curve between these lines
     hover_line_1 = part->getPoint(i);
     hover_line_2 = part->getPoint(i + 1);
@@ -537,8 +544,19 @@ bool SymbolPointEditor::checkPosOnCurve(const Vector2D& pos) {
 
 SelectedHandle SymbolPointEditor::findHandle(const Vector2D& pos) {
   double range = control.rotation.trInvS(3); // less then 3 pixels away is still a hit
+  // Only the end points of segments near pos can be in range
+  if (!part->segments.validFor(part->points.size())) part->updateBounds();
+  vector<UInt> near_segments, near_points;
+  part->segments.find(pos, range, near_segments);
+  FOR_EACH_CONST(s, near_segments) {
+    near_points.push_back(s);
+    near_points.push_back((s + 1) % (UInt)part->points.size());
+  }
+  sort(near_points.begin(), near_points.end());
+  near_points.erase(unique(near_points.begin(), near_points.end()), near_points.end());
   // Is there a main handle there?
-  FOR_EACH(p, part->points) {
+  FOR_EACH_CONST(i, near_points) {
+    const ControlPointP& p = part->points[i];
     if (inRange(p->pos, pos, range)) {
       // point is at pos
       return SelectedHandle(p, HANDLE_MAIN);
@@ -546,7 +564,8 @@ SelectedHandle SymbolPointEditor::findHandle(const Vector2D& pos) {
   }
   // Is there a sub handle there?
   // only check visible handles
-  for (int i = 0 ; (size_t)i < part->points.size() ; ++i) {
+  FOR_EACH_CONST(near_point, near_points) {
+    int i = (int)near_point;
     ControlPointP p = part->getPoint(i);
     bool sel    = pointSelected(p);
     bool before = sel || pointSelected(part->getPoint(i-1)); // are the handles visible?
@@ -315,6 +315,7 @@ IMPLEMENT_VALUE_EDITOR(Text)
   , selection_start_i(0), selection_end_i(0)
   , selecting(false), select_words(false)
   , scrollbar(nullptr), scroll_with_cursor(false)
+  , position_map_age(0)
   , hovered_words(nullptr)
 {
   if (nativeLook() && field().multi_line) {
@@ -519,7 +520,7 @@ String spellcheck_word_at(const String& str, size_t start) {
   return untag(str.substr(start,end-start));
 }
 
-void spellcheck_language_at(const String& str, size_t error_pos, SpellChecker** out) {
+void spellcheck_language_at(const String& str, size_t error_pos, SpellCheckerP* out) {
   String tag  = tag_at(str,error_pos);
   size_t pos  = min(tag.find_first_of(_(':')), tag.size()-1);
   size_t pos2 = min(tag.find_first_of(_(':'),pos+1), tag.size());
@@ -535,7 +536,7 @@ void spellcheck_language_at(const String& str, size_t error_pos, SpellChecker**
 void get_spelling_suggestions(const String& str, size_t error_pos, vector<String>& suggestions_out) {
   String word = spellcheck_word_at(str, error_pos);
   // find dictionaries
-  SpellChecker* checkers[3] = {nullptr};
+  SpellCheckerP checkers[3];
   spellcheck_language_at(str, error_pos, checkers);
   // suggestions
   for (size_t i = 0 ; checkers[i] ; ++i) {
@@ -744,6 +745,7 @@ RealRect TextValueEditor::boundingBoxBorder() const {
 
 void TextValueEditor::onValueChange() {
   TextValueViewer::onValueChange();
+  position_map.reset(); // this can be a different value
   selection_start   = selection_end   = 0;
   selection_start_i = selection_end_i = 0;
   findWordLists();
@@ -751,6 +753,7 @@ void TextValueEditor::onValueChange() {
 
 void TextValueEditor::onAction(const Action& action, bool undone) {
   TextValueViewer::onAction(action, undone);
+  position_map.reset();
   findWordLists();
   TYPE_CASE(action, TextValueAction) {
     selection_start = action.selection_start;
@@ -994,13 +997,18 @@ void TextValueEditor::replaceSelection(const String& replacement, const String&
     return;
   }
   // what we would expect if no scripts take place
-  String expected_value  = untag_for_cursor(action->newValue());
+  String expected_tagged = action->newValue();
   size_t expected_cursor = min(selection_start, selection_end) + untag_for_cursor(replacement).size();
   // perform the action
   // NOTE: this calls our onAction, invalidating the text viewer and moving the selection around the new text
   addAction(std::move(action));
   // move cursor
-  {
+  if (value().value() == expected_tagged) {
+    // scripts didn't change anything, so the cursor is where we expected
+    selection_end = selection_start = expected_cursor;
+    fixSelection(TYPE_CURSOR, MOVE_RIGHT);
+  } else {
+    String expected_value = untag_for_cursor(expected_tagged);
     String real_value = untag_for_cursor(value().value());
     // where real and expected value are the same, nothing has happend, so don't look there
     size_t start, end_min;
@@ -1089,29 +1097,38 @@ Movement direction_of(size_t a, size_t b) {
   else       return MOVE_MID;
 }
 
+const TaggedPositions& TextValueEditor::positions() const {
+  if (!position_map || !(position_map_age == value().last_update)) {
+    position_map = make_unique<TaggedPositions>(value().value());
+    position_map_age = value().last_update;
+  }
+  return *position_map;
+}
+
 void TextValueEditor::fixSelection(IndexType t, Movement dir) {
   const String& val = value().value();
+  const TaggedPositions& pos = positions();
   // Which type takes precedent?
   if (t == TYPE_INDEX) {
-    selection_start = index_to_cursor(value().value(), selection_start_i, dir);
-    selection_end   = index_to_cursor(value().value(), selection_end_i,   dir);
+    selection_start = pos.indexToCursor(selection_start_i, dir);
+    selection_end   = pos.indexToCursor(selection_end_i,   dir);
   }
   // make sure the selection is at a valid position inside the text
   // prepare to move 'inward' (i.e. from start in the direction of end and vice versa)
-  selection_start_i = cursor_to_index(val, selection_start, direction_of(selection_end, selection_start));
-  selection_end_i   = cursor_to_index(val, selection_end,   direction_of(selection_start, selection_end));
+  selection_start_i = pos.cursorToIndex(selection_start, direction_of(selection_end, selection_start));
+  selection_end_i   = pos.cursorToIndex(selection_end,   direction_of(selection_start, selection_end));
   // start and end must be on the same side of separators
   size_t seppos = val.find(_("<sep"));
   while (seppos != String::npos) {
     size_t sepend = match_close_tag_end(val, seppos);
     if (selection_start_i <= seppos && selection_end_i > seppos) {
         // not on same side, move selection end before sep
-      selection_end   = index_to_cursor(val, seppos, dir);
-      selection_end_i = cursor_to_index(val, selection_end, direction_of(selection_start, selection_end));
+      selection_end   = pos.indexToCursor(seppos, dir);
+      selection_end_i = pos.cursorToIndex(selection_end, direction_of(selection_start, selection_end));
     } else if (selection_start_i >= sepend && selection_end_i < sepend) {
         // not on same side, move selection end after sep
-      selection_end   = index_to_cursor(val, sepend, dir);
-      selection_end_i = cursor_to_index(val, selection_end, direction_of(selection_start, selection_end));
+      selection_end   = pos.indexToCursor(sepend, dir);
+      selection_end_i = pos.cursorToIndex(selection_end, direction_of(selection_start, selection_end));
     }
     // find next separator
     seppos = val.find(_("<sep"), seppos + 1);
@@ -1123,7 +1140,7 @@ size_t TextValueEditor::prevCharBoundary(size_t pos) const {
   return max(0, (int)pos - 1);
 }
 size_t TextValueEditor::nextCharBoundary(size_t pos) const {
-  return min(index_to_cursor(value().value(), String::npos), pos + 1);
+  return min(positions().indexToCursor(String::npos), pos + 1);
 }
 
 static const Char word_bound_chars[] = _(" ,.:;()\n");
@@ -1202,31 +1219,17 @@ size_t TextValueEditor::move(size_t pos, size_t start, size_t end, Movement dir)
 
 // ----------------------------------------------------------------------------- : Search / replace
 
-bool is_word_end(const String& s, size_t pos) {
-  if (pos == 0 || pos >= s.size()) return true;
-  Char c = s.GetChar(pos);
-  return isSpace(c) || isPunct(c);
-}
-
 // is find.findString() at postion pos of s
 bool TextValueEditor::matchSubstr(const String& s, size_t pos, FindInfo& find) {
-  if (pos >= s.size()) return false;
-  if (find.wholeWord()) {
-    if (!is_word_end(s, pos - 1) || !is_word_end(s, pos + find.findString().size())) return false;
-  }
-  if (find.caseSensitive()) {
-    if (!is_substr(s, pos, find.findString())) return false;
-  } else {
-    if (!is_substr(s, pos, find.findString().Lower())) return false;
-  }
+  if (!find.matchesAt(s, pos)) return false;
   // handle
   bool was_selection = false;
   if (find.select()) {
     editor().select(this);
     editor().SetFocus();
     size_t old_sel_start = selection_start, old_sel_end = selection_end;
-    selection_start_i = untagged_to_index(value().value(), pos,                            true);
-    selection_end_i   = untagged_to_index(value().value(), pos + find.findString().size(), true);
+    selection_start_i = positions().untaggedToIndex(pos,                            true);
+    selection_end_i   = positions().untaggedToIndex(pos + find.findString().size(), true);
     fixSelection(TYPE_INDEX);
     was_selection = old_sel_start == selection_start && old_sel_end == selection_end;
   }
@@ -1239,10 +1242,9 @@ bool TextValueEditor::matchSubstr(const String& s, size_t pos, FindInfo& find) {
 }
 
 bool TextValueEditor::search(FindInfo& find, bool from_start) {
-  String v = untag(value().value());
-  if (!find.caseSensitive()) v.LowerCase();
-  size_t selection_min = index_to_untagged(value().value(), min(selection_start_i, selection_end_i));
-  size_t selection_max = index_to_untagged(value().value(), max(selection_start_i, selection_end_i));
+  String v = find.searchString(value().value());
+  size_t selection_min = positions().indexToUntagged(min(selection_start_i, selection_end_i));
+  size_t selection_max = positions().indexToUntagged(max(selection_start_i, selection_end_i));
   if (find.forward()) {
     size_t start = min(v.size(), find.searchSelection() ? selection_min : selection_max);
     for (size_t i = start ; i + find.findString().size() <= v.size() ; ++i) {
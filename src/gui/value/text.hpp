@@ -105,6 +105,12 @@ private:
   TextValueEditorScrollBar* scrollbar;       ///< Scrollbar for multiline fields in native look
   bool scroll_with_cursor;                   ///< When the cursor moves, should the scrollposition change?
   vector<WordListPosP> word_lists;           ///< Word lists in the text
+  mutable unique_ptr<TaggedPositions> position_map; ///< Position map of the value, see positions()
+  mutable Age position_map_age;                     ///< last_update of the value when position_map was built
+  
+  /// Map for converting between positions in the current value
+  /** Rebuilt only when the value has changed, as seen by its last_update age */
+  const TaggedPositions& positions() const;
   
   // --------------------------------------------------- : Selection / movement
   
@@ -16,13 +16,16 @@
 #include <data/installer.hpp>
 #include <data/format/formats.hpp>
 #include <cli/cli_main.hpp>
+#include <cli/benchmark.hpp>
 #include <cli/text_io_handler.hpp>
+#include <script/optimizer.hpp>
 #include <gui/welcome_window.hpp>
 #include <gui/update_checker.hpp>
 #include <gui/packages_window.hpp>
 #include <gui/set/window.hpp>
 #include <gui/symbol/window.hpp>
 #include <gui/thumbnail_thread.hpp>
+#include <render/value/image_cache.hpp>
 #include <wx/fs_inet.h>
 #include <wx/wfstream.h>
 #include <wx/txtstrm.h>
@@ -100,10 +103,16 @@ int MSE::OnRun() {
     // interpret command line
     {
       // ingnore the --color argument, it is handled by cli.init()
+      // --no-script-optimization can be combined with any other option
       vector<String> args;
       for (int i = 1; i < argc; ++i) {
         args.push_back(argv[i]);
-        if (args.back() == _("--color")) args.pop_back();
+        if (args.back() == _("--color")) {
+          args.pop_back();
+        } else if (args.back() == _("--no-script-optimization")) {
+          script_optimization_enabled = false;
+          args.pop_back();
+        }
       }
       if (!args.empty()) {
         const String& arg = args[0];
@@ -198,6 +207,24 @@ int MSE::OnRun() {
           cli << _("\n         \tStart the command line interface for performing commands on the set file.");
           cli << _("\n         \tUse ") << BRIGHT << _("-q") << NORMAL << _(" or ") << BRIGHT << _("--quiet") << NORMAL << _(" to supress the startup banner and prompts.");
           cli << _("\n         \tUse ") << BRIGHT << _("-raw") << NORMAL << _(" for raw output mode.");
+          cli << _("\n\n  ") << BRIGHT << _("--batch") << NORMAL;
+          cli << _("\n         \tRead commands from the standard input in raw output mode, as for ") << BRIGHT << _("--cli") << NORMAL << _(".");
+          cli << _("\n         \tPackages and parsed scripts are kept between commands, and image files are written in the background.");
+          cli << _("\n         \tUse ") << BRIGHT << _(":wait") << NORMAL << _(" to wait for the images to be written.");
+          cli << _("\n\n  ") << BRIGHT << _("--benchmark") << NORMAL << _(" [")
+                             << BRIGHT << _("--data") << NORMAL << PARAM << _(" DIR") << NORMAL << _("] [")
+                             << BRIGHT << _("--cards") << NORMAL << PARAM << _(" N") << NORMAL << _("] [")
+                             << BRIGHT << _("--golden") << NORMAL << PARAM << _(" DIR") << NORMAL << _("] [")
+                             << BRIGHT << _("--update-golden") << NORMAL << _("] [")
+                             << BRIGHT << _("--require-golden") << NORMAL << _("] [")
+                             << BRIGHT << _("--output") << NORMAL << PARAM << _(" FILE") << NORMAL << _("]");
+          cli << _("\n         \tRender a generated set without showing any windows, and report timings as JSON.");
+          cli << _("\n         \tThe packages are loaded from ") << PARAM << _("DIR") << NORMAL << _(", see test/benchmark for the bundled ones.");
+          cli << _("\n         \tThe first cards are compared against the golden images, use ")
+              << BRIGHT << _("--update-golden") << NORMAL << _(" to regenerate them.");
+          cli << _("\n         \tWith ") << BRIGHT << _("--require-golden") << NORMAL << _(" missing golden images are an error.");
+          cli << _("\n\n  ") << BRIGHT << _("--no-script-optimization") << NORMAL;
+          cli << _("\n         \tDon't optimize scripts after parsing them, can be combined with the other options.");
           cli << _("\n\nRaw output mode is intended for use by other programs:");
           cli << _("\n    - The only output is only in response to commands.");
           cli << _("\n    - For each command a single 'record' is written to the standard output.");
@@ -232,6 +259,14 @@ int MSE::OnRun() {
           }
           CLISetInterface cli_interface(set,quiet);
           return EXIT_SUCCESS;
+        } else if (arg == _("--batch")) {
+          // long running command line interface, for processing many jobs
+          cli.enableRaw();
+          CLISetInterface cli_interface(SetP(), true, true, true);
+          return EXIT_SUCCESS;
+        } else if (arg == _("--benchmark")) {
+          // rendering benchmark
+          return run_benchmark(vector<String>(args.begin() + 1, args.end()));
         } else if (arg == _("--export-images")) {
           if (args.size() < 2) {
             handle_error(Error(_("No input file specified for --export")));
@@ -242,16 +277,8 @@ int MSE::OnRun() {
           String out = args.size() >= 3 && !starts_with(args[2], _("--"))
             ? args[2]
             : settings.gameSettingsFor(*set->game).images_export_filename;
-          String path = _(".");
-          size_t pos = out.find_last_of(_("/\\"));
-          if (pos != String::npos) {
-            path = out.substr(0, pos);
-            if (!wxDirExists(path)) wxMkdir(path);
-            path += _("/x");
-            out = out.substr(pos + 1);
-          }
           // export
-          export_images(set, set->cards, path, out, CONFLICT_NUMBER_OVERWRITE);
+          export_images(set, set->cards, out, CONFLICT_NUMBER_OVERWRITE);
           return EXIT_SUCCESS;
         } else if (args[0] == _("--export")) {
           if (args.size() < 2) {
@@ -292,6 +319,7 @@ int MSE::runGUI() {
 
 int MSE::OnExit() {
   thumbnail_thread.abortAll();
+  decoded_image_cache.clear();
   settings.write();
   package_manager.destroy();
   SpellChecker::destroyAll();
@@ -219,6 +219,20 @@ void DataViewer::onAction(const Action& action, bool undone) {
       }
     }
   }
+  TYPE_CASE(action, ReplaceAllAction) {
+    bool changed = false;
+    FOR_EACH_CONST(a, action.actions) {
+      if (a->card != card) continue;
+      FOR_EACH(v, viewers) {
+        if (v->getValue()->equals( a->valueP.get() )) {
+          v->onAction(*a, undone);
+          changed = true;
+        }
+      }
+    }
+    if (changed) onChange();
+    return;
+  }
   TYPE_CASE(action, ScriptValueEvent) {
     if (action.card == card.get()) {
       FOR_EACH(v, viewers) {
@@ -54,6 +54,9 @@ public:
   inline const CardP& getCard() const { return card; }
   /// Invalidate and redraw (the area of) a single value viewer
   virtual void redraw(const ValueViewer&) {}
+  /// Can images be loaded in the background, showing a placeholder until they are done?
+  /** false by default, since exported images should be complete */
+  virtual bool loadImagesInBackground() const { return false; }
   
   /// The package containing style stuff like images
   virtual Package& getStylePackage() const;
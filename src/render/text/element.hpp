@@ -47,7 +47,8 @@ struct CharInfo {
 };
 
 /// A section of text that can be rendered using a TextViewer
-class TextElement : public IntrusivePtrBase<TextElement> {
+/** Elements are only used by the TextViewer that owns them, so they don't need an atomic reference count */
+class TextElement : public IntrusivePtrBase<TextElement, LocalRefCount> {
 public:
   /// What section of the input string is this element?
   size_t start, end;
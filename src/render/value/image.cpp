@@ -8,6 +8,7 @@
 
 #include <util/prec.hpp>
 #include <render/value/image.hpp>
+#include <render/value/image_cache.hpp>
 #include <render/card/viewer.hpp>
 #include <gui/util.hpp>
 
@@ -15,6 +16,16 @@
 
 IMPLEMENT_VALUE_VIEWER(Image);
 
+ImageValueViewer::~ImageValueViewer() {
+  decoded_image_cache.forget(this);
+}
+
+void ImageValueViewer::onImageReady(void* owner) {
+  ImageValueViewer* viewer = static_cast<ImageValueViewer*>(owner);
+  viewer->bitmap = Bitmap();
+  viewer->parent.redraw(*viewer);
+}
+
 void ImageValueViewer::draw(RotatedDC& dc) {
   DrawWhat what = drawWhat();
   // reset?
@@ -29,12 +40,13 @@ void ImageValueViewer::draw(RotatedDC& dc) {
     angle = a;
     is_default = false;
     Image image;
-    // load from file
+    // load from file, possibly cached
     if (!value().filename.empty()) {
       try {
-        auto image_file = getLocalPackage().openIn(value().filename);
-        if (image_load_file(image, *image_file)) {
-          image.Rescale(w, h);
+        if (parent.loadImagesInBackground()) {
+          image = decoded_image_cache.get(getLocalPackage(), value().filename.toStringForKey(), w, h, this, onImageReady);
+        } else {
+          image = decoded_image_cache.get(getLocalPackage(), value().filename.toStringForKey(), w, h);
         }
       } CATCH_ALL_ERRORS(false);
     }
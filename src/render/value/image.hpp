@@ -20,6 +20,7 @@ DECLARE_POINTER_TYPE(AlphaMask);
 class ImageValueViewer : public ValueViewer {
 public:
   DECLARE_VALUE_VIEWER(Image) : ValueViewer(parent,style) {}
+  ~ImageValueViewer();
   
   void draw(RotatedDC& dc) override;
   void onValueChange() override;
@@ -31,6 +32,9 @@ private:
   Radians angle;  ///< Angle of cached bitmap
   bool    is_default; ///< Is the default placeholder image used?
   
+  /// Called when an image requested from decoded_image_cache is available
+  static void onImageReady(void* viewer);
+  
   /// Generate a placeholder image
   static Bitmap imagePlaceholder(const Rotation& rot, UInt w, UInt h, const Image& background, bool editing);
 };
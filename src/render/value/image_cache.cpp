@@ -0,0 +1,307 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <render/value/image_cache.hpp>
+#include <util/io/package.hpp>
+#include <util/error.hpp>
+#include <gui/util.hpp>
+#include <wx/mstream.h>
+
+// ----------------------------------------------------------------------------- : Constants
+
+/// Default memory budget for decoded images
+const size_t DEFAULT_IMAGE_CACHE_BUDGET = 256 << 20;
+/// Don't make mip levels smaller than this
+const int MIN_MIP_LEVEL_SIZE = 64;
+/// Maximum number of background threads
+const int MAX_DECODE_WORKERS = 2;
+/// Don't prefetch when there are this many images waiting to be decoded
+const size_t MAX_PREFETCH_QUEUE = 8;
+/// Maximum number of images bigger than the budget waiting to be picked up by their owners
+const size_t MAX_OVERSIZED = 4;
+
+DecodedImageCache decoded_image_cache;
+
+// ----------------------------------------------------------------------------- : DecodedImageWorker
+
+class DecodedImageWorker : public wxThread {
+public:
+  DecodedImageWorker(DecodedImageCache& cache) : wxThread(wxTHREAD_JOINABLE), cache(cache) {}
+
+  ExitCode Entry() override {
+    wxMutexLocker lock(cache.mutex);
+    while (true) {
+      while (cache.jobs.empty() && !cache.stopping) {
+        cache.work_available.Wait();
+      }
+      if (cache.stopping) return 0;
+      DecodedImageCache::Job job = std::move(cache.jobs.front());
+      cache.jobs.pop_front();
+      // decode without holding the lock
+      cache.mutex.Unlock();
+      DecodedImageCache::decode(job);
+      cache.mutex.Lock();
+      cache.finished.push_back(std::move(job));
+      if (wxTheApp) wxTheApp->CallAfter([]{ decoded_image_cache.onFinished(); });
+    }
+  }
+
+private:
+  DecodedImageCache& cache;
+};
+
+// ----------------------------------------------------------------------------- : DecodedImageCache
+
+bool DecodedImageCache::Key::operator < (const Key& that) const {
+  if (package  != that.package)  return package  < that.package;
+  if (filename != that.filename) return filename < that.filename;
+  return modified < that.modified;
+}
+
+DecodedImageCache::DecodedImageCache()
+  : memory_budget(DEFAULT_IMAGE_CACHE_BUDGET)
+  , memory_usage(0)
+  , work_available(mutex)
+  , stopping(false)
+{}
+
+DecodedImageCache::~DecodedImageCache() {
+  clear();
+}
+
+void DecodedImageCache::clear() {
+  {
+    wxMutexLocker lock(mutex);
+    stopping = true;
+    jobs.clear();
+    work_available.Broadcast();
+  }
+  FOR_EACH(w, workers) {
+    w->Wait();
+    delete w;
+  }
+  workers.clear();
+  stopping = false;
+  finished.clear();
+  waiting.clear();
+  oversized.clear();
+  entries.clear();
+  lru.clear();
+  memory_usage = 0;
+}
+
+void DecodedImageCache::setMemoryBudget(size_t bytes) {
+  memory_budget = bytes;
+  enforceBudget();
+}
+
+DecodedImageCache::Key DecodedImageCache::makeKey(Package& package, const String& filename) {
+  Key key = {package.absoluteFilename(), filename, package.fileModificationTime(filename).GetValue()};
+  return key;
+}
+
+Image DecodedImageCache::get(Package& package, const String& filename, int width, int height, void* owner, ReadyFunction on_ready) {
+  assert(wxThread::IsMain());
+  storeFinished();
+  Key key = makeKey(package, filename);
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    // decoded in the background, but too large to cache?
+    auto o = oversized.find(key);
+    if (o != oversized.end()) {
+      Image image = resample(o->second, width, height);
+      oversized.erase(o);
+      return image;
+    }
+    bool background = on_ready && owner;
+    if (background) {
+      // already being decoded?
+      auto w = waiting.find(key);
+      if (w != waiting.end()) {
+        if (find(w->second.begin(), w->second.end(), make_pair(owner, on_ready)) == w->second.end()) {
+          w->second.push_back(make_pair(owner, on_ready));
+        }
+        return Image();
+      }
+    }
+    Job job;
+    job.key = key;
+    if (background) {
+      if (startDecode(job, package, filename)) {
+        waiting[key].push_back(make_pair(owner, on_ready));
+        return Image();
+      }
+      // no threads, decode it here
+    } else {
+      readFile(job, package, filename);
+    }
+    decode(job);
+    Image image = resample(job.levels, width, height);
+    store(key, job.levels, false);
+    return image;
+  }
+  // most recently used
+  Entry& entry = it->second;
+  lru.splice(lru.begin(), lru, entry.lru);
+  return resample(entry.levels, width, height);
+}
+
+Image DecodedImageCache::resample(const vector<Image>& levels, int width, int height) {
+  if (levels.empty()) return Image(); // not an image
+  // find the smallest level that is large enough
+  size_t level = 0;
+  while (level + 1 < levels.size() &&
+         levels[level + 1].GetWidth()  >= width &&
+         levels[level + 1].GetHeight() >= height) {
+    ++level;
+  }
+  const Image& image = levels[level];
+  if (image.GetWidth() == width && image.GetHeight() == height) {
+    return image.Copy();
+  } else {
+    return image.Scale(width, height);
+  }
+}
+
+void DecodedImageCache::prefetch(Package& package, const String& filename) {
+  assert(wxThread::IsMain());
+  storeFinished();
+  Key key = makeKey(package, filename);
+  if (entries.find(key) != entries.end() || waiting.find(key) != waiting.end() || oversized.find(key) != oversized.end()) return;
+  {
+    wxMutexLocker lock(mutex);
+    if (jobs.size() >= MAX_PREFETCH_QUEUE) return;
+  }
+  Job job;
+  job.key = key;
+  if (startDecode(job, package, filename)) {
+    waiting[key]; // pending, but nobody to notify yet
+  }
+}
+
+void DecodedImageCache::readFile(Job& job, Package& package, const String& filename) {
+  // read the file here, packages can't be used from other threads
+  auto stream = package.openIn(filename);
+  char buffer[4096];
+  while (stream->Read(buffer, sizeof(buffer)).LastRead() > 0) {
+    job.data.AppendData(buffer, stream->LastRead());
+  }
+}
+
+bool DecodedImageCache::startDecode(Job& job, Package& package, const String& filename) {
+  readFile(job, package, filename);
+  wxMutexLocker lock(mutex);
+  if (workers.size() < (size_t)min(MAX_DECODE_WORKERS, max(1, wxThread::GetCPUCount()))) {
+    DecodedImageWorker* w = new DecodedImageWorker(*this);
+    if (w->Run() == wxTHREAD_NO_ERROR) {
+      workers.push_back(w);
+    } else {
+      delete w;
+    }
+  }
+  if (workers.empty()) return false;
+  jobs.push_back(std::move(job));
+  work_available.Signal();
+  return true;
+}
+
+void DecodedImageCache::forget(void* owner) {
+  FOR_EACH(w, waiting) {
+    auto& owners = w.second;
+    for (size_t i = 0 ; i < owners.size() ; ) {
+      if (owners[i].first == owner) {
+        owners.erase(owners.begin() + i);
+      } else {
+        ++i;
+      }
+    }
+  }
+}
+
+void DecodedImageCache::decode(Job& job) {
+  job.levels.clear();
+  if (job.data.GetDataLen() == 0) return;
+  wxMemoryInputStream stream(job.data.GetData(), job.data.GetDataLen());
+  Image image;
+  if (!image_load_file(image, stream) || !image.Ok()) return;
+  job.data = wxMemoryBuffer(); // no longer needed
+  job.levels.push_back(image);
+  while (true) {
+    const Image& last = job.levels.back();
+    int w = last.GetWidth() / 2, h = last.GetHeight() / 2;
+    if (w < MIN_MIP_LEVEL_SIZE || h < MIN_MIP_LEVEL_SIZE) break;
+    job.levels.push_back(last.Scale(w, h, wxIMAGE_QUALITY_BOX_AVERAGE));
+  }
+}
+
+void DecodedImageCache::storeFinished() {
+  vector<Job> done;
+  {
+    wxMutexLocker lock(mutex);
+    swap(done, finished);
+  }
+  vector<pair<void*,ReadyFunction>> notify;
+  FOR_EACH(job, done) {
+    auto it = waiting.find(job.key);
+    bool has_owners = it != waiting.end() && !it->second.empty();
+    // an image that is too large to cache is handed to the owners once,
+    // otherwise their redraw would decode it again, and again
+    store(job.key, job.levels, has_owners);
+    if (it != waiting.end()) {
+      notify.insert(notify.end(), it->second.begin(), it->second.end());
+      waiting.erase(it);
+    }
+  }
+  // the owners might request other images
+  FOR_EACH(n, notify) {
+    n.second(n.first);
+  }
+}
+
+void DecodedImageCache::onFinished() {
+  storeFinished();
+}
+
+void DecodedImageCache::store(const Key& key, vector<Image>& levels, bool keep_oversized) {
+  // note: an entry without levels means the file is not an image, don't try to decode it again
+  size_t bytes = 0;
+  FOR_EACH_CONST(l, levels) {
+    bytes += (size_t)l.GetWidth() * l.GetHeight() * (l.HasAlpha() ? 4 : 3);
+  }
+  if (bytes > memory_budget) {
+    if (keep_oversized) {
+      // owners that were forgotten never pick up their image, don't keep too many of those
+      if (oversized.size() >= MAX_OVERSIZED) oversized.erase(oversized.begin());
+      oversized[key].swap(levels);
+    }
+    return;
+  }
+  auto inserted = entries.insert(make_pair(key, Entry()));
+  Entry& entry = inserted.first->second;
+  if (inserted.second) {
+    lru.push_front(key);
+    entry.lru = lru.begin();
+  } else {
+    memory_usage -= entry.bytes;
+    lru.splice(lru.begin(), lru, entry.lru);
+  }
+  entry.levels.swap(levels);
+  entry.bytes = bytes;
+  memory_usage += bytes;
+  enforceBudget();
+}
+
+void DecodedImageCache::enforceBudget() {
+  while (memory_usage > memory_budget && !lru.empty()) {
+    auto it = entries.find(lru.back());
+    memory_usage -= it->second.bytes;
+    entries.erase(it);
+    lru.pop_back();
+  }
+}
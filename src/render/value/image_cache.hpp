@@ -0,0 +1,116 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <wx/thread.h>
+#include <list>
+#include <deque>
+
+class Package;
+class DecodedImageWorker;
+
+// ----------------------------------------------------------------------------- : DecodedImageCache
+
+/// A cache of decoded images from packages, such as card art, at multiple resolutions
+/** Each image is stored as a list of mip levels, every level half the size of the previous one.
+ *  Images of any size are resampled from the smallest level that is large enough.
+ *  Images are identified by package, filename and modification time, so a changed file is decoded again.
+ *
+ *  Decoding can be done in the background, the owner is notified on the main thread when it is done.
+ *  The cached images themselves are only touched from the main thread.
+ */
+class DecodedImageCache {
+public:
+  DecodedImageCache();
+  ~DecodedImageCache();
+
+  /// Function called on the main thread when an image requested by owner has been decoded
+  typedef void (*ReadyFunction)(void* owner);
+
+  /// Get an image from a package, resampled to the given size
+  /** If the image is not yet decoded and on_ready is set, it is decoded in the background.
+   *  Then an invalid image is returned, and on_ready(owner) is called once it is available.
+   *  Otherwise it is decoded immediatly.
+   *  Returns an invalid image if the file can not be decoded.
+   */
+  Image get(Package& package, const String& filename, int width, int height, void* owner = nullptr, ReadyFunction on_ready = nullptr);
+
+  /// Start decoding an image in the background, so a later get() is fast
+  /** Does nothing if the image is already cached or being decoded, or if there is already enough work queued */
+  void prefetch(Package& package, const String& filename);
+
+  /// Don't notify the owner about any requests
+  void forget(void* owner);
+
+  /// Change the maximum amount of memory used by the decoded images
+  void setMemoryBudget(size_t bytes);
+
+  /// Stop all background work, and clear the cache
+  /** *must* be called at application exit */
+  void clear();
+
+private:
+  struct Key {
+    String   package;  ///< Absolute filename of the package
+    String   filename; ///< Filename inside the package
+    wxLongLong modified; ///< Modification time of the file
+    bool operator < (const Key& that) const;
+  };
+  struct Entry {
+    vector<Image> levels;   ///< Mip levels, largest first
+    size_t        bytes;
+    std::list<Key>::iterator lru;
+  };
+  struct Job {
+    Key            key;
+    wxMemoryBuffer data; ///< Contents of the file
+    vector<Image>  levels; ///< Result
+  };
+
+  map<Key,Entry> entries;
+  std::list<Key> lru;        ///< Most recently used first
+  size_t memory_budget;
+  size_t memory_usage;
+
+  map<Key,vector<pair<void*,ReadyFunction>>> waiting; ///< Owners to notify for pending requests, contains all pending keys
+  map<Key,vector<Image>> oversized; ///< Decoded images bigger than the whole budget, given to the next get() and then dropped
+
+  wxMutex             mutex;     ///< Protects jobs, finished and stopping
+  wxCondition         work_available;
+  std::deque<Job>     jobs;      ///< Files to decode
+  vector<Job>         finished;  ///< Decoded files, to be added to the cache on the main thread
+  bool                stopping;
+  vector<DecodedImageWorker*> workers;
+  friend class DecodedImageWorker;
+
+  /// Key for a file in a package
+  static Key makeKey(Package& package, const String& filename);
+  /// Read a file, and queue it to be decoded by a worker thread
+  /** Returns false if there are no worker threads, then the job is left for the caller */
+  bool startDecode(Job& job, Package& package, const String& filename);
+  /// Read a file from a package into a job
+  static void readFile(Job& job, Package& package, const String& filename);
+  /// Decode an image file, and make the mip levels
+  static void decode(Job& job);
+  /// Move finished jobs into the cache, and notify their owners
+  void storeFinished();
+  /// Called from the main thread after a job is finished
+  void onFinished();
+  /// Add an image to the cache
+  /** Images bigger than the budget are not cached, they are kept in oversized if keep_oversized is set */
+  void store(const Key& key, vector<Image>& levels, bool keep_oversized);
+  /// Resample the best mip level to the given size
+  static Image resample(const vector<Image>& levels, int width, int height);
+  /// Remove the least recently used entries until we are within the budget
+  void enforceBudget();
+};
+
+/// The global cache of decoded images
+extern DecodedImageCache decoded_image_cache;
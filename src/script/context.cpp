@@ -96,7 +96,7 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
         
         // Get a variable
         case I_GET_VAR: {
-          ScriptValueP value = variables[i.data].value;
+          const ScriptValueP& value = variables[i.data].value;
           if (!value) throw ScriptErrorNoVariable(variable_to_string((Variable)i.data));
           stack.push_back(value);
           break;
@@ -117,7 +117,7 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
           ScriptValueP& it = stack[stack.size() - 2]; // second element of stack
           ScriptValueP val = it->next();
           if (val) {
-            stack.push_back(val);
+            stack.push_back(std::move(val));
           } else {
             stack.erase(stack.end() - 2); // remove iterator
             instr = &script.instructions[0] + i.data;
@@ -130,8 +130,8 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
           ScriptValueP key;
           ScriptValueP val = it->next(&key);
           if (val) {
-            stack.push_back(val);
-            stack.push_back(key);
+            stack.push_back(std::move(val));
+            stack.push_back(std::move(key));
           } else {
             stack.erase(stack.end() - 2); // remove iterator
             instr = &script.instructions[0] + i.data;
@@ -150,22 +150,23 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
         case I_TAILCALL: {
           // prepare arguments
           for (unsigned int j = 0 ; j < i.data ; ++j) {
-            setVariable((Variable)instr[i.data - j - 1].data, stack.back());
+            setVariable((Variable)instr[i.data - j - 1].data, std::move(stack.back()));
             stack.pop_back();
           }
           instr += i.data; // skip arguments
           try {
             #if USE_SCRIPT_PROFILING
               Timer timer;
-              const Instruction* instr_bt = script.backtraceSkip(instr - i.data - 2, i.data);
-              Variable function = instr_bt && instr_bt->instr == I_GET_VAR
-                                ? (Variable)instr_bt->data
-                                : (Variable)-1;
+              Variable function = (Variable)-1;
+              if (profiling_enabled()) {
+                const Instruction* instr_bt = script.backtraceSkip(instr - i.data - 2, i.data);
+                if (instr_bt && instr_bt->instr == I_GET_VAR) function = (Variable)instr_bt->data;
+              }
               Profiler prof(timer, function);
             #endif
             // get function and call.
             // there is no need to open a new scope for this function, since we already did so for the arguments
-            stack.back() = stack.back()->eval(*this, false);
+            stack.back() = evalFunction(*stack.back(), false);
             // finish profiling
             #if USE_SCRIPT_PROFILING
               //profile_add(function, timer.time());
@@ -204,24 +205,24 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
         }
         // Simple instruction: binary
         case I_BINARY: {
-          ScriptValueP  b = stack.back(); stack.pop_back();
+          ScriptValueP  b = std::move(stack.back()); stack.pop_back();
           ScriptValueP& a = stack.back();
           instrBinary(i.instr2, a, b);
           break;
         }
         // Simple instruction: ternary
         case I_TERNARY: {
-          ScriptValueP  c = stack.back(); stack.pop_back();
-          ScriptValueP  b = stack.back(); stack.pop_back();
+          ScriptValueP  c = std::move(stack.back()); stack.pop_back();
+          ScriptValueP  b = std::move(stack.back()); stack.pop_back();
           ScriptValueP& a = stack.back();
           instrTernary(i.instr3, a, b, c);
           break;
         }
         // Simple instruction: quaternary
         case I_QUATERNARY: {
-          ScriptValueP  d = stack.back(); stack.pop_back();
-          ScriptValueP  c = stack.back(); stack.pop_back();
-          ScriptValueP  b = stack.back(); stack.pop_back();
+          ScriptValueP  d = std::move(stack.back()); stack.pop_back();
+          ScriptValueP  c = std::move(stack.back()); stack.pop_back();
+          ScriptValueP  b = std::move(stack.back()); stack.pop_back();
           ScriptValueP& a = stack.back();
           instrQuaternary(i.instr4, a, b, c, d);
           break;
@@ -244,7 +245,7 @@ ScriptValueP Context::eval(const Script& script, bool useScope) {
     // restore shadowed variables
     if (useScope) closeScope(scope);
     // return top of stack
-    ScriptValueP result = stack.back();
+    ScriptValueP result = std::move(stack.back());
     stack.pop_back();
     assert(stack.size() == stack_size); // we end up with the same stack
     return result;
@@ -265,18 +266,18 @@ void Context::setVariable(const String& name, const ScriptValueP& value) {
   extern vector<String> variable_names;
 #endif
 
-void Context::setVariable(Variable name, const ScriptValueP& value) {
+void Context::setVariable(Variable name, ScriptValueP value) {
   #ifdef _DEBUG
     assert((size_t)name < variable_names.size());
   #endif
   VariableValue& var = variables[name];
   if (var.level < level) {
-    // keep shadow copy
-    Binding bind = {name, var};
-    shadowed.push_back(bind);
+    // keep shadow copy, the old value is overwritten below so it can be moved
+    Binding bind = {name, std::move(var)};
+    shadowed.push_back(std::move(bind));
   }
   var.level = level;
-  var.value = value;
+  var.value = std::move(value);
 }
 
 ScriptValueP Context::getVariable(const String& name) {
@@ -357,6 +358,54 @@ void Context::closeScope(size_t scope) {
   }
 }
 
+// ----------------------------------------------------------------------------- : Memoization
+
+/// Forget all memoized results when there are more than this many
+const size_t MAX_MEMO_ENTRIES = 4096;
+/// Don't memoize calls with huge parameters, comparing the keys would cost more than it saves
+const size_t MAX_MEMO_KEY_SIZE = 2048;
+
+thread_local size_t script_memo_hits   = 0;
+thread_local size_t script_memo_misses = 0;
+
+bool Context::memoKey(const Variable* params, size_t count, String& key) {
+  for (size_t i = 0 ; i < count ; ++i) {
+    const ScriptValueP& value = variables[params[i]].value;
+    if (!value) {
+      key += _("-;"); // not set
+    } else if (!value->appendMemoKey(key)) {
+      return false;
+    }
+    if (key.size() > MAX_MEMO_KEY_SIZE) return false;
+  }
+  return true;
+}
+
+ScriptValueP Context::evalFunction(const ScriptValue& fun, bool openScope) {
+  String key;
+  if (!fun.memoKey(*this, key)) {
+    return fun.eval(*this, openScope);
+  }
+  auto memo_key = make_pair(&fun, key);
+  auto it = memo.find(memo_key);
+  if (it != memo.end()) {
+    ++script_memo_hits;
+    #if USE_SCRIPT_PROFILING
+      Profiler::countMemoHit();
+    #endif
+    return it->second;
+  }
+  ++script_memo_misses;
+  ScriptValueP result = fun.eval(*this, openScope);
+  // only remember simple values, not collections or delayed errors
+  ScriptType type = result->type();
+  if (type == SCRIPT_NIL || type == SCRIPT_INT || type == SCRIPT_BOOL || type == SCRIPT_DOUBLE || type == SCRIPT_STRING || type == SCRIPT_COLOR) {
+    if (memo.size() >= MAX_MEMO_ENTRIES) memo.clear();
+    memo.insert(make_pair(std::move(memo_key), result));
+  }
+  return result;
+}
+
 // ----------------------------------------------------------------------------- : Simple instructions : unary
 
 void instrUnary(UnaryInstructionType i, ScriptValueP& a) {
@@ -581,7 +630,7 @@ void Context::makeObject(size_t n) {
 void Context::makeClosure(size_t n, const Instruction*& instr) {
   intrusive_ptr<ScriptClosure> closure(new ScriptClosure(stack[stack.size() - n - 1]));
   for (size_t j = 0 ; j < n ; ++j) {
-    closure->addBinding((Variable)instr[n - j - 1].data, stack.back());
+    closure->addBinding((Variable)instr[n - j - 1].data, std::move(stack.back()));
     stack.pop_back();
   }
   // skip arguments
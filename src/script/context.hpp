@@ -12,6 +12,11 @@
 
 class Dependency;
 
+/// Number of calls to pure functions on this thread that were answered from the memo cache (see Context::evalFunction)
+extern thread_local size_t script_memo_hits;
+/// Number of calls to pure functions on this thread that had to be evaluated
+extern thread_local size_t script_memo_misses;
+
 // ----------------------------------------------------------------------------- : VectorIntMap
 
 /// A map like data structure that stores the elements in a vector.
@@ -49,11 +54,23 @@ public:
    *  The return value of this function should be ignored
    */
   ScriptValueP dependencies(const Dependency& dep, const Script& script);
+  
+  /// Call a function, i.e. fun.eval(*this, openScope)
+  /** The results of pure functions (see ScriptValue::memoKey) are remembered,
+   *  a later call with the same parameter values returns the same result without evaluating the function again.
+   *  The parameters must already be set in this context.
+   */
+  ScriptValueP evalFunction(const ScriptValue& fun, bool openScope = true);
+  /// Make a memo key from the current values of the given parameters, for ScriptValue::memoKey
+  /** Parameters that are not set are part of the key as well.
+   *  Returns false if a value can't be used in a memo key.
+   */
+  bool memoKey(const Variable* params, size_t count, String& key);
     
   /// Set a variable to a new value (in the current scope)
   void setVariable(const String& name, const ScriptValueP& value);
   /// Set a variable to a new value (in the current scope)
-  void setVariable(Variable name, const ScriptValueP& value);
+  void setVariable(Variable name, ScriptValueP value);
   
   /// Get the value of a variable, throws if it not set
   ScriptValueP getVariable(const String& name);
@@ -104,6 +121,8 @@ private:
   unsigned int level;
   /// Stack of values
   vector<ScriptValueP> stack;
+  /// Results of calls to pure functions, by function and memo key
+  map<pair<const ScriptValue*,String>, ScriptValueP> memo;
   #ifdef _DEBUG
     /// The opened scopes, for sanity checking
     vector<size_t> scopes;
@@ -319,37 +319,37 @@ SCRIPT_FUNCTION(pow) {
 // ----------------------------------------------------------------------------- : String stuff
 
 // convert a string to upper case
-SCRIPT_FUNCTION(to_upper) {
+SCRIPT_PURE_FUNCTION(to_upper, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(input.Upper());
 }
 
 // convert a string to lower case
-SCRIPT_FUNCTION(to_lower) {
+SCRIPT_PURE_FUNCTION(to_lower, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(input.Lower());
 }
 
 // convert a string to title case
-SCRIPT_FUNCTION(to_title) {
+SCRIPT_PURE_FUNCTION(to_title, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(capitalize(input.Lower()));
 }
 
 // reverse a string
-SCRIPT_FUNCTION(reverse) {
+SCRIPT_PURE_FUNCTION(reverse, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(reverse_string(input));
 }
 
 // remove leading and trailing whitespace from a string
-SCRIPT_FUNCTION(trim) {
+SCRIPT_PURE_FUNCTION(trim, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(trim(input));
 }
 
 // extract a substring
-SCRIPT_FUNCTION(substring) {
+SCRIPT_PURE_FUNCTION(substring, SCRIPT_VAR_input, SCRIPT_VAR_begin, SCRIPT_VAR_end) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_PARAM_DEFAULT_C(int, begin, 0);
   SCRIPT_PARAM_DEFAULT_C(int, end,   INT_MAX);
@@ -365,25 +365,25 @@ SCRIPT_FUNCTION(substring) {
 }
 
 // does a string contain a substring?
-SCRIPT_FUNCTION(contains) {
+SCRIPT_PURE_FUNCTION(contains, SCRIPT_VAR_input, SCRIPT_VAR_match) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_PARAM_C(String, match);
   SCRIPT_RETURN(input.find(match) != String::npos);
 }
 
-SCRIPT_FUNCTION(format) {
+SCRIPT_PURE_FUNCTION(format, SCRIPT_VAR_format, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, format);
   SCRIPT_PARAM_C(ScriptValueP, input);
   SCRIPT_RETURN(format_input(format,*input));
 }
 
-SCRIPT_FUNCTION(curly_quotes) {
+SCRIPT_PURE_FUNCTION(curly_quotes, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(curly_quotes(input,true));
 }
 
 // regex escape a string
-SCRIPT_FUNCTION(regex_escape) {
+SCRIPT_PURE_FUNCTION(regex_escape, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(regex_escape(input));
 }
@@ -396,7 +396,7 @@ void sort_string(String& input) {
   input.clear();
   for (auto c : chars) input += c;
 }
-SCRIPT_FUNCTION(sort_text) {
+SCRIPT_PURE_FUNCTION(sort_text, SCRIPT_VAR_input, SCRIPT_VAR_order) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_OPTIONAL_PARAM_C(String, order) {
     SCRIPT_RETURN(spec_sort(order, input));
@@ -443,14 +443,14 @@ SCRIPT_FUNCTION(tag_contents) {
   SCRIPT_RETURN(replace_tag_contents(input, tag, contents, ctx));
 }
 
-SCRIPT_FUNCTION(remove_tag) {
+SCRIPT_PURE_FUNCTION(remove_tag, SCRIPT_VAR_input, SCRIPT_VAR_tag) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_PARAM_C(String, tag);
   assert_tagged(input, false);
   SCRIPT_RETURN(remove_tag(input, tag));
 }
 
-SCRIPT_FUNCTION(remove_tags) {
+SCRIPT_PURE_FUNCTION(remove_tags, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   assert_tagged(input, false);
   SCRIPT_RETURN(untag_no_escape(input));
@@ -133,19 +133,19 @@ String do_english_num(String input, String(*fun)(int)) {
   }
 }
 
-SCRIPT_FUNCTION(english_number) {
+SCRIPT_PURE_FUNCTION(english_number, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(do_english_num(input, english_number));
 }
-SCRIPT_FUNCTION(english_number_a) {
+SCRIPT_PURE_FUNCTION(english_number_a, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(do_english_num(input, english_number_a));
 }
-SCRIPT_FUNCTION(english_number_multiple) {
+SCRIPT_PURE_FUNCTION(english_number_multiple, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(do_english_num(input, english_number_multiple));
 }
-SCRIPT_FUNCTION(english_number_ordinal) {
+SCRIPT_PURE_FUNCTION(english_number_ordinal, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(do_english_num(input, english_ordinal));
 }
@@ -210,11 +210,11 @@ String do_english(String input, String(*fun)(const String&)) {
   }
 }
 
-SCRIPT_FUNCTION(english_singular) {
+SCRIPT_PURE_FUNCTION(english_singular, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(do_english(input, english_singular));
 }
-SCRIPT_FUNCTION(english_plural) {
+SCRIPT_PURE_FUNCTION(english_plural, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_RETURN(do_english(input, english_plural));
 }
@@ -325,7 +325,7 @@ String process_english_hints(const String& str) {
   return ret;
 }
 
-SCRIPT_FUNCTION(process_english_hints) {
+SCRIPT_PURE_FUNCTION(process_english_hints, SCRIPT_VAR_input) {
   SCRIPT_PARAM_C(String, input);
   assert_tagged(input);
   SCRIPT_RETURN(process_english_hints(input));
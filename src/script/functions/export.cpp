@@ -202,7 +202,7 @@ String symbols_to_html(const String& str, SymbolFont& symbol_font, double size)
       wxFileName fn;
       fn.SetPath(ei.directory_absolute);
       fn.SetFullName(filename);
-      img.SaveFile(fn.GetFullPath());
+      ei.image_writes.write(img, fn.GetFullPath());
       it = ei.exported_images.insert(make_pair(filename, wxSize(img.GetWidth(), img.GetHeight()))).first;
     }
     html += _("<img src='") + filename + _("' alt='") + html_escape(sym.text)
@@ -440,9 +440,9 @@ SCRIPT_FUNCTION(write_image_file) {
     image = input->toImage()->generateConform(options);
   }
   if (!image.Ok()) throw Error(_("Unable to generate image for file ") + file);
-  // write
+  // write in the background, the size is already known
   ensure_dir_valid(out_path);
-  image.SaveFile(out_path);
+  ei.image_writes.write(image, out_path);
   ei.exported_images.insert(make_pair(file, wxSize(image.GetWidth(), image.GetHeight())));
   SCRIPT_RETURN(file);
 }
@@ -22,10 +22,15 @@ public:
   ScriptType type() const override { return SCRIPT_REGEX; }
   String typeName() const override { return _("regex"); }
   
-  ScriptRegex(const String& code) {
+  ScriptRegex(const String& code) : code(code) {
     assign(code);
   }
   
+  bool appendMemoKey(String& key) const override {
+    key << _('r') << (unsigned long)code.size() << _(':') << code;
+    return true;
+  }
+  
   /// Match only if in_context also matches
   bool matches(Results& results, const String& str, String::const_iterator begin, const ScriptRegexP& in_context) {
     if (!in_context) {
@@ -51,6 +56,8 @@ public:
     }
   }
   using Regex::matches;
+private:
+  String code; ///< The regular expression this was compiled from, for memo keys
 };
 
 ScriptRegexP regex_from_script(const ScriptValueP& value) {
@@ -110,7 +117,7 @@ struct RegexReplacer {
   }
 };
 
-SCRIPT_FUNCTION_WITH_SIMPLIFY(replace_text) {
+SCRIPT_PURE_FUNCTION_WITH_SIMPLIFY(replace_text, SCRIPT_VAR_input, SCRIPT_VAR_match, SCRIPT_VAR_replace, SCRIPT_VAR_in_context, SCRIPT_VAR_recursive) {
   // construct replacer
   RegexReplacer replacer;
   replacer.match = from_script<ScriptRegexP>(ctx.getVariable(SCRIPT_VAR_match), SCRIPT_VAR_match);
@@ -151,7 +158,7 @@ SCRIPT_FUNCTION_SIMPLIFY_CLOSURE(replace_text) {
 
 // ----------------------------------------------------------------------------- : Rules : regex filter
 
-SCRIPT_FUNCTION_WITH_SIMPLIFY(filter_text) {
+SCRIPT_PURE_FUNCTION_WITH_SIMPLIFY(filter_text, SCRIPT_VAR_input, SCRIPT_VAR_match, SCRIPT_VAR_in_context) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_PARAM_C(ScriptRegexP, match);
   SCRIPT_OPTIONAL_PARAM_C_(ScriptRegexP, in_context);
@@ -241,7 +248,7 @@ SCRIPT_FUNCTION_SIMPLIFY_CLOSURE(split_text) {
 
 // ----------------------------------------------------------------------------- : Rules : regex match
 
-SCRIPT_FUNCTION_WITH_SIMPLIFY(match_text) {
+SCRIPT_PURE_FUNCTION_WITH_SIMPLIFY(match_text, SCRIPT_VAR_input, SCRIPT_VAR_match) {
   SCRIPT_PARAM_C(String, input);
   SCRIPT_PARAM_C(ScriptRegexP, match);
   SCRIPT_RETURN(match->matches(input));
@@ -16,37 +16,29 @@
 
 // ----------------------------------------------------------------------------- : Functions
 
-inline size_t spelled_correctly(const String& input, size_t start, size_t end, SpellChecker** checkers, const ScriptValueP& extra_test, Context& ctx) {
-  // untag
-  String word = untag(input.substr(start,end-start));
-  if (word.empty()) return true;
-  // run through spellchecker(s)
-  for (size_t i = 0 ; checkers[i] ; ++i) {
-    if (checkers[i]->spell(word)) {
-      return true;
-    }
-  }
-  // run through additional words regex
-  if (extra_test) {
-    // try on untagged
-    ctx.setVariable(SCRIPT_VAR_input, to_script(word));
-    if (extra_test->eval(ctx)->toBool()) {
-      return true;
-    }
-    // try on tagged
-    ctx.setVariable(SCRIPT_VAR_input, to_script(input.substr(start,end-start)));
-    if (extra_test->eval(ctx)->toBool()) {
-      return true;
-    }
+/// A word in the input of check_spelling
+struct SpellingWord {
+  size_t start, end;  ///< Position in the input
+  size_t result_pos;  ///< Position in the result (without any of the words)
+  bool check;         ///< Should the word be checked?
+  size_t unique;      ///< Index in the list of unique untagged words
+};
+
+/// Does the word pass the additional words test?
+bool extra_test_passes(const String& tagged, const String& word, const ScriptValueP& extra_test, Context& ctx) {
+  // try on untagged
+  ctx.setVariable(SCRIPT_VAR_input, to_script(word));
+  if (extra_test->eval(ctx)->toBool()) {
+    return true;
   }
-  return false;
+  // try on tagged
+  ctx.setVariable(SCRIPT_VAR_input, to_script(tagged));
+  return extra_test->eval(ctx)->toBool();
 }
 
-void check_word(const String& tag, const String& input, size_t start, size_t end, String& out, bool check, SpellChecker** checkers, const ScriptValueP& extra_test, Context& ctx) {
-  if (start >= end) return;
-  bool good = !check || spelled_correctly(input, start, end, checkers, extra_test, ctx);
+void check_word(const String& tag, const String& input, const SpellingWord& word, bool good, String& out) {
   if (!good) { out += _("<"); out += tag; }
-  out.append(input, start, end-start);
+  out.append(input, word.start, word.end - word.start);
   if (!good) { out += _("</"); out += tag; }
 }
 
@@ -69,7 +61,7 @@ SCRIPT_FUNCTION(check_spelling) {
   if (language.empty()) {
     SCRIPT_RETURN(input);
   }
-  SpellChecker* checkers[3] = {nullptr};
+  SpellCheckerP checkers[3];
   checkers[0] = SpellChecker::get(language);
   if (!extra_dictionary.empty()) {
     checkers[1] = SpellChecker::get(extra_dictionary,language);
@@ -81,8 +73,21 @@ SCRIPT_FUNCTION(check_spelling) {
     tag += _(":") + extra_dictionary;
   }
   tag += _(">");
-  // now walk over the words in the input, and mark misspellings
+  // now walk over the words in the input, and collect the words to check
   String result;
+  vector<SpellingWord> words;
+  vector<String> unique_words;          // untagged words to check, each only once
+  unordered_map<String,size_t> word_ids; // index in unique_words
+  auto add_word = [&](size_t start, size_t end, bool check) {
+    if (start >= end) return;
+    SpellingWord word = {start, end, result.size(), check, 0};
+    if (check) {
+      auto it = word_ids.emplace(untag(input.substr(start, end - start)), unique_words.size());
+      if (it.second) unique_words.push_back(it.first->first);
+      word.unique = it.first->second;
+    }
+    words.push_back(word);
+  };
   size_t word_start = String::npos; // start of the word to be checked, or npos if not inside a word
   size_t pos = 0;
   int unchecked_tag = 0;
@@ -115,8 +120,7 @@ SCRIPT_FUNCTION(check_spelling) {
       ++pos;
     } else {
       // a non-word character, punctuation or space
-      // check word, add to result
-      check_word(tag, input, word_start, pos, result, check_this_word, checkers, extra_match, ctx);
+      add_word(word_start, pos, check_this_word);
       word_start = String::npos;
       check_this_word = unchecked_tag <= 0;
       result += c;
@@ -124,10 +128,29 @@ SCRIPT_FUNCTION(check_spelling) {
     }
   }
   // last word
-  check_word(tag, input, word_start, input.size(), result, check_this_word, checkers, extra_match, ctx);
+  add_word(word_start, input.size(), check_this_word);
+  // run the unique words through the spellchecker(s), each checker only sees the words that are still wrong
+  vector<bool> correct(unique_words.size(), false);
+  for (size_t i = 0 ; checkers[i] ; ++i) {
+    checkers[i]->spell(unique_words, correct);
+  }
+  // mark misspellings
+  String marked;
+  size_t result_pos = 0;
+  FOR_EACH_CONST(word, words) {
+    marked.append(result, result_pos, word.result_pos - result_pos);
+    result_pos = word.result_pos;
+    bool good = !word.check || unique_words[word.unique].empty() || correct[word.unique];
+    if (!good && extra_match) {
+      // run through additional words regex
+      good = extra_test_passes(input.substr(word.start, word.end - word.start), unique_words[word.unique], extra_match, ctx);
+    }
+    check_word(tag, input, word, good, marked);
+  }
+  marked.append(result, result_pos, String::npos);
   // done
-  assert_tagged(result);
-  SCRIPT_RETURN(result);
+  assert_tagged(marked);
+  SCRIPT_RETURN(marked);
 }
 
 SCRIPT_FUNCTION(check_spelling_word) {
@@ -50,6 +50,31 @@
 #define SCRIPT_FUNCTION_SIMPLIFY_CLOSURE(name) \
     ScriptValueP ScriptBuiltIn_##name::simplifyClosure(ScriptClosure& closure) const
 
+/// Macro to declare a new pure script function
+/** A pure function has no side effects, and its result depends only on the listed parameters.
+ *  Calls to pure functions are memoized, see Context::evalFunction.
+ *  Usage:
+ *  @code
+ *   SCRIPT_PURE_FUNCTION(my_function, SCRIPT_VAR_input, SCRIPT_VAR_match) {
+ *      // function code goes here, it may only use the parameters input and match
+ *   }
+ *  @endcode
+ */
+#define SCRIPT_PURE_FUNCTION(name, ...) \
+    SCRIPT_FUNCTION_AUX(name, SCRIPT_FUNCTION_MEMO_KEY(__VA_ARGS__))
+
+/// Macro to declare a new pure script function with custom closure simplification
+#define SCRIPT_PURE_FUNCTION_WITH_SIMPLIFY(name, ...) \
+    SCRIPT_FUNCTION_AUX(name, ScriptValueP simplifyClosure(ScriptClosure&) const override; \
+                              SCRIPT_FUNCTION_MEMO_KEY(__VA_ARGS__))
+
+// helper for SCRIPT_PURE_FUNCTION, the memo key consists of the values of the parameters
+#define SCRIPT_FUNCTION_MEMO_KEY(...) \
+    bool memoKey(Context& ctx, String& key) const override { \
+      static const Variable params[] = {__VA_ARGS__}; \
+      return ctx.memoKey(params, sizeof(params) / sizeof(params[0]), key); \
+    }
+
 // helper for SCRIPT_FUNCTION and SCRIPT_FUNCTION_DEP
 #define SCRIPT_FUNCTION_AUX(name,dep) \
     class ScriptBuiltIn_##name : public ScriptValue { \
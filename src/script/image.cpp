@@ -190,9 +190,30 @@ template <> void GetDefaultMember::handle(const CachedScriptableImage& s) {
 // ----------------------------------------------------------------------------- : CachedScriptableMask
 
 
+/// Number of derived sizes to keep, besides the source
+const size_t MAX_SCALED_MASKS = 4;
+/// Returned when there is no mask
+static const AlphaMask no_mask;
+
+CachedScriptableMask::CachedScriptableMask(const CachedScriptableMask& that)
+  : script(that.script)
+  , current(that.current)
+{
+  wxMutexLocker lock(that.mutex);
+  source = that.source;
+  scaled = that.scaled;
+}
+
+void CachedScriptableMask::clearCache() {
+  wxMutexLocker lock(mutex);
+  source = AlphaMaskP();
+  scaled.clear();
+}
+
 bool CachedScriptableMask::update(Context& ctx) {
   if (script.update(ctx)) {
-    mask.clear();
+    current = AlphaMaskP();
+    clearCache();
     return true;
   } else {
     return false;
@@ -200,21 +221,68 @@ bool CachedScriptableMask::update(Context& ctx) {
 }
 
 const AlphaMask& CachedScriptableMask::get(const GeneratedImage::Options& img_options) {
-  if (mask.isLoaded()) {
+  if (current) {
     // already loaded?
-    if (img_options.width == 0 && img_options.height == 0) return mask;
-    if (mask.hasSize(wxSize(img_options.width,img_options.height))) return mask;
+    if (img_options.width == 0 && img_options.height == 0) return *current;
+    if (current->hasSize(wxSize(img_options.width,img_options.height))) return *current;
   }
   // load?
-  getNoCache(img_options,mask);
+  current = getShared(img_options);
+  return current ? *current : no_mask;
+}
+
+const AlphaMask& CachedScriptableMask::getFromCache() const {
+  return current ? *current : no_mask;
+}
+
+AlphaMaskP CachedScriptableMask::getShared(const GeneratedImage::Options& img_options) const {
+  if (script.isBlank()) return AlphaMaskP();
+  wxSize size(img_options.width, img_options.height);
+  {
+    wxMutexLocker lock(mutex);
+    if (source) {
+      if (size.x == 0 && size.y == 0) return source;
+      if (source->hasSize(size))      return source;
+      for (size_t i = 0 ; i < scaled.size() ; ++i) {
+        if (scaled[i]->hasSize(size)) {
+          AlphaMaskP mask = scaled[i];
+          scaled.erase(scaled.begin() + i);
+          scaled.insert(scaled.begin(), mask);
+          return mask;
+        }
+      }
+      // a smaller size can be derived from the source
+      if (size.x > 0 && size.y > 0 && size.x <= source->getSize().x && size.y <= source->getSize().y) {
+        AlphaMaskP mask = make_intrusive<AlphaMask>();
+        mask->loadScaled(*source, size);
+        scaled.insert(scaled.begin(), mask);
+        if (scaled.size() > MAX_SCALED_MASKS) scaled.pop_back();
+        return mask;
+      }
+    }
+  }
+  // generate a new mask, without holding the lock
+  Image image = script.generate(img_options);
+  AlphaMaskP mask = make_intrusive<AlphaMask>(image);
+  wxMutexLocker lock(mutex);
+  const wxSize& new_size = mask->getSize();
+  if (!source || (double)new_size.x * new_size.y > (double)source->getSize().x * source->getSize().y) {
+    // a better source for deriving other sizes
+    if (source) scaled.insert(scaled.begin(), source);
+    source = mask;
+  } else {
+    scaled.insert(scaled.begin(), mask);
+  }
+  if (scaled.size() > MAX_SCALED_MASKS) scaled.pop_back();
   return mask;
 }
+
 void CachedScriptableMask::getNoCache(const GeneratedImage::Options& img_options, AlphaMask& other_mask) const {
-  if (script.isBlank()) {
-    other_mask.clear();
+  AlphaMaskP mask = getShared(img_options);
+  if (mask) {
+    other_mask.loadScaled(*mask, mask->getSize());
   } else {
-    Image image = script.generate(img_options);
-    other_mask.load(image);
+    other_mask.clear();
   }
 }
 
@@ -15,6 +15,7 @@
 #include <gfx/generated_image.hpp>
 
 class CachedScriptableMask;
+DECLARE_POINTER_TYPE(AlphaMask);
 
 // ----------------------------------------------------------------------------- : ScriptableImage
 
@@ -107,8 +108,16 @@ private:
 // ----------------------------------------------------------------------------- : CachedScriptableMask
 
 /// A version of ScriptableImage that caches an AlphaMask
+/** Masks are cached at multiple resolutions: the largest generated mask is kept as the source,
+ *  and smaller sizes (for zooming and exporting) are derived from it, instead of running the script again.
+ *  The cache is protected by a mutex, and the masks themselves are never modified once made,
+ *  so they can be handed to other threads.
+ */
 class CachedScriptableMask {
 public:
+  CachedScriptableMask() {}
+  /// Copies share the cached masks
+  CachedScriptableMask(const CachedScriptableMask& that);
   
   /// Update the script, returns true if the value has changed
   bool update(Context& ctx);
@@ -123,16 +132,26 @@ public:
    */
   const AlphaMask& get(const GeneratedImage::Options& img_options);
   
-  /// Get a mask that is not cached
+  /// Get the alpha mask with the given options, or nullptr if there is no mask
+  /** Unlike get(), the result stays valid. */
+  AlphaMaskP getShared(const GeneratedImage::Options& img_options) const;
+  
+  /// Get a copy of the mask, that is not affected by later calls
   void getNoCache(const GeneratedImage::Options& img_options, AlphaMask& mask) const;
   
   /// Get the mask directly from the cache, without updating
   /** Should only be used after get() was called before, otherwise an old mask might be returned */
-  inline const AlphaMask& getFromCache() const { return mask; }
+  const AlphaMask& getFromCache() const;
   
 private:
   ScriptableImage script;
-  AlphaMask       mask;
+  AlphaMaskP      current;         ///< The mask returned by the last call to get()
+  mutable wxMutex mutex;           ///< Protects source and scaled
+  mutable AlphaMaskP source;       ///< The largest mask generated from the script
+  mutable vector<AlphaMaskP> scaled; ///< Other sizes, most recently used first
+  
+  /// Forget all cached masks
+  void clearCache();
   friend class Reader;
   friend class Writer;
   friend class GetDefaultMember;
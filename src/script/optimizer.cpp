@@ -0,0 +1,366 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <script/optimizer.hpp>
+#include <script/to_value.hpp>
+#include <util/error.hpp>
+
+bool script_optimization_enabled = true;
+
+// from context.cpp
+void instrUnary     (UnaryInstructionType      i, ScriptValueP& a);
+void instrBinary    (BinaryInstructionType     i, ScriptValueP& a, const ScriptValueP& b);
+void instrTernary   (TernaryInstructionType    i, ScriptValueP& a, const ScriptValueP& b, const ScriptValueP& c);
+void instrQuaternary(QuaternaryInstructionType i, ScriptValueP& a, const ScriptValueP& b, const ScriptValueP& c, const ScriptValueP& d);
+
+// ----------------------------------------------------------------------------- : Instructions
+
+/// Does the instruction have an address as data?
+static bool is_jump(InstructionType t) {
+  return t == I_JUMP || t == I_JUMP_IF_NOT || t == I_JUMP_SC_AND || t == I_JUMP_SC_OR
+      || t == I_LOOP || t == I_LOOP_WITH_KEY;
+}
+
+/// Number of argument names (I_NOPs) following an instruction
+static size_t argument_count(const Instruction& i) {
+  if (i.instr == I_CALL || i.instr == I_TAILCALL || i.instr == I_CLOSURE) return i.data;
+  return 0;
+}
+
+/// Is a value of a simple immutable type, that can be the operand or result of constant folding?
+/** Functions, collections and iterators are excluded, operators on them make new objects with their own identity and state. */
+static bool is_simple_constant(const ScriptValueP& v) {
+  switch (v->type()) {
+    case SCRIPT_NIL: case SCRIPT_INT: case SCRIPT_BOOL: case SCRIPT_DOUBLE: case SCRIPT_STRING: case SCRIPT_COLOR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// ----------------------------------------------------------------------------- : ScriptOptimizer
+
+/// Optimizer for the instructions of a single script
+/** Each pass marks instructions as removed, and changes others in place.
+ *  After a pass the removed instructions are taken out, and all jumps are updated.
+ *  A jump to a removed instruction goes to the next instruction that is kept.
+ */
+class ScriptOptimizer {
+public:
+  ScriptOptimizer(Script& script)
+    : instructions(script.getInstructions())
+    , constants(script.getConstants())
+  {}
+
+  void optimize() {
+    if (!isValid()) return;
+    // repeat until nothing changes, folding can enable other optimizations and vice versa
+    bool changed = true;
+    while (changed) {
+      changed  = pass(&ScriptOptimizer::foldConstants);
+      changed |= pass(&ScriptOptimizer::foldBranches);
+      changed |= pass(&ScriptOptimizer::threadJumps);
+      changed |= pass(&ScriptOptimizer::peephole);
+      changed |= pass(&ScriptOptimizer::removeUnreachable);
+    }
+    removeUnusedConstants();
+  }
+
+private:
+  vector<Instruction>&  instructions;
+  vector<ScriptValueP>& constants;
+  vector<bool> removed;   ///< Instructions to remove at the end of the pass
+  vector<bool> is_target; ///< Is there a jump to an instruction? (or to the end, at index size())
+
+  /// Are all jumps and calls well formed? Not the case for some scripts with parse errors
+  bool isValid() const {
+    for (size_t pos = 0 ; pos < instructions.size() ; pos += 1 + argument_count(instructions[pos])) {
+      const Instruction& i = instructions[pos];
+      if (is_jump(i.instr) && i.data > instructions.size()) return false;
+      if (pos + argument_count(i) >= instructions.size()) return false;
+    }
+    return true;
+  }
+
+  /// Perform an optimization pass, returns true if something changed
+  bool pass(bool (ScriptOptimizer::*fun)()) {
+    removed.assign(instructions.size(), false);
+    findTargets();
+    bool changed = (this->*fun)();
+    compact();
+    return changed;
+  }
+
+  void findTargets() {
+    is_target.assign(instructions.size() + 1, false);
+    for (size_t pos = 0 ; pos < instructions.size() ; pos += 1 + argument_count(instructions[pos])) {
+      if (is_jump(instructions[pos].instr)) is_target[instructions[pos].data] = true;
+    }
+  }
+
+  /// Is any position in the range [begin,end) a jump target?
+  bool hasTarget(size_t begin, size_t end) const {
+    for (size_t p = begin ; p < end ; ++p) {
+      if (is_target[p]) return true;
+    }
+    return false;
+  }
+
+  /// Find the previous instruction before pos that is not removed, returns false if there is none
+  /** Argument names of calls are never returned, since they are not instructions on their own. */
+  bool previous(size_t pos, size_t& prev) const {
+    while (pos > 0) {
+      --pos;
+      if (removed[pos]) continue;
+      if (instructions[pos].instr == I_NOP) return false; // argument of a call, or something we don't understand
+      prev = pos;
+      return true;
+    }
+    return false;
+  }
+
+  /// The value pushed by an I_PUSH_CONST
+  const ScriptValueP& constantAt(size_t pos) const {
+    return constants[instructions[pos].data];
+  }
+
+  /// Replace an instruction by pushing a constant
+  void setConstant(size_t pos, const ScriptValueP& value) {
+    constants.push_back(value);
+    instructions[pos].instr = I_PUSH_CONST;
+    instructions[pos].data  = (unsigned int)constants.size() - 1;
+  }
+
+  // --------------------------------------------------- : Passes
+
+  /// Evaluate simple instructions with constant operands
+  bool foldConstants() {
+    bool changed = false;
+    for (size_t pos = 0 ; pos < instructions.size() ; pos += 1 + argument_count(instructions[pos])) {
+      const Instruction i = instructions[pos];
+      size_t arity = 0;
+      switch (i.instr) {
+        case I_UNARY:      arity = i.instr1 == I_ITERATOR_C ? 0 : 1; break;
+        case I_BINARY:     arity = i.instr2 == I_ITERATOR_R || i.instr2 == I_MEMBER ? 0 : 2; break;
+        case I_TERNARY:    arity = 3; break;
+        case I_QUATERNARY: arity = 4; break;
+        default: break;
+      }
+      if (arity == 0) continue;
+      // find the operands, they must all be constants, and there must be no jumps into the middle
+      size_t operands[4];
+      size_t p = pos;
+      bool ok = true;
+      for (size_t k = arity ; k > 0 && ok ; --k) {
+        ok = previous(p, p)
+          && instructions[p].instr == I_PUSH_CONST
+          && is_simple_constant(constantAt(p));
+        operands[k - 1] = p;
+      }
+      if (!ok || hasTarget(operands[0] + 1, pos + 1)) continue;
+      // evaluate
+      ScriptValueP a = constantAt(operands[0]);
+      try {
+        switch (i.instr) {
+          case I_UNARY:
+            instrUnary(i.instr1, a);
+            break;
+          case I_BINARY:
+            if ((i.instr2 == I_DIV || i.instr2 == I_MOD) && constantAt(operands[1])->toDouble() == 0) {
+              continue; // leave division by zero for run time
+            }
+            instrBinary(i.instr2, a, constantAt(operands[1]));
+            break;
+          case I_TERNARY:
+            instrTernary(i.instr3, a, constantAt(operands[1]), constantAt(operands[2]));
+            break;
+          case I_QUATERNARY:
+            instrQuaternary(i.instr4, a, constantAt(operands[1]), constantAt(operands[2]), constantAt(operands[3]));
+            break;
+          default: break;
+        }
+      } catch (const Error&) {
+        continue; // the error should happen at run time
+      }
+      if (!is_simple_constant(a)) continue;
+      for (size_t k = 0 ; k < arity ; ++k) removed[operands[k]] = true;
+      setConstant(pos, a);
+      changed = true;
+    }
+    return changed;
+  }
+
+  /// Conditional jumps on a constant
+  bool foldBranches() {
+    bool changed = false;
+    for (size_t pos = 0 ; pos < instructions.size() ; pos += 1 + argument_count(instructions[pos])) {
+      Instruction& i = instructions[pos];
+      if (i.instr != I_JUMP_IF_NOT && i.instr != I_JUMP_SC_AND && i.instr != I_JUMP_SC_OR) continue;
+      size_t cond;
+      if (!previous(pos, cond) || instructions[cond].instr != I_PUSH_CONST || hasTarget(cond + 1, pos + 1)) continue;
+      bool value;
+      try {
+        value = constantAt(cond)->toBool();
+      } catch (const Error&) {
+        continue;
+      }
+      bool jump = i.instr == I_JUMP_SC_OR ? value : !value;
+      if (!jump) {
+        // fall through, the condition is popped
+        removed[cond] = true;
+        removed[pos]  = true;
+      } else if (i.instr == I_JUMP_IF_NOT) {
+        // always jump, the condition is popped
+        removed[cond] = true;
+        i.instr = I_JUMP;
+      } else {
+        // always jump, the condition stays on the stack
+        i.instr = I_JUMP;
+      }
+      changed = true;
+    }
+    return changed;
+  }
+
+  /// Jumps to jumps
+  bool threadJumps() {
+    bool changed = false;
+    for (size_t pos = 0 ; pos < instructions.size() ; pos += 1 + argument_count(instructions[pos])) {
+      Instruction& i = instructions[pos];
+      if (i.instr != I_JUMP && i.instr != I_JUMP_IF_NOT && i.instr != I_JUMP_SC_AND && i.instr != I_JUMP_SC_OR) continue;
+      // Note: I_LOOP is not threaded, error backtraces recognize loops by the target of the I_LOOP instruction
+      // only thread to forward jumps, dependency analysis requires conditional jumps to go forward
+      while (i.data < instructions.size() && i.data != pos) {
+        const Instruction& target = instructions[i.data];
+        bool follow = target.instr == I_JUMP
+                   || (i.instr == I_JUMP_SC_AND && target.instr == I_JUMP_SC_AND) // the value is still false
+                   || (i.instr == I_JUMP_SC_OR  && target.instr == I_JUMP_SC_OR); // the value is still true
+        if (!follow || target.data <= i.data) break;
+        i.data = target.data;
+        changed = true;
+      }
+      // jump to the next instruction
+      if (i.instr == I_JUMP && i.data == pos + 1) {
+        removed[pos] = true;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  /// Small patterns of instructions
+  bool peephole() {
+    bool changed = false;
+    for (size_t pos = 0 ; pos < instructions.size() ; pos += 1 + argument_count(instructions[pos])) {
+      Instruction& i = instructions[pos];
+      size_t prev;
+      if (i.instr == I_POP && previous(pos, prev) && !hasTarget(prev + 1, pos + 1)) {
+        InstructionType p = instructions[prev].instr;
+        if (p == I_PUSH_CONST || p == I_DUP) {
+          // push; pop  -->  nothing
+          removed[prev] = true;
+          removed[pos]  = true;
+          changed = true;
+        }
+      } else if (i.instr == I_GET_VAR && previous(pos, prev) && instructions[prev].instr == I_POP && !hasTarget(prev, pos + 1)) {
+        // set x; pop; get x  -->  set x
+        size_t set;
+        if (previous(prev, set) && instructions[set].instr == I_SET_VAR && instructions[set].data == i.data) {
+          removed[prev] = true;
+          removed[pos]  = true;
+          changed = true;
+        }
+      }
+    }
+    return changed;
+  }
+
+  /// Remove instructions that can not be reached
+  bool removeUnreachable() {
+    vector<bool> reachable(instructions.size(), false);
+    vector<size_t> todo(1, 0);
+    while (!todo.empty()) {
+      size_t pos = todo.back(); todo.pop_back();
+      if (pos >= instructions.size() || reachable[pos]) continue;
+      const Instruction& i = instructions[pos];
+      size_t args = argument_count(i);
+      for (size_t k = 0 ; k <= args && pos + k < instructions.size() ; ++k) {
+        reachable[pos + k] = true;
+      }
+      if (is_jump(i.instr)) todo.push_back(i.data);
+      if (i.instr != I_JUMP) todo.push_back(pos + 1 + args);
+    }
+    bool changed = false;
+    for (size_t pos = 0 ; pos < instructions.size() ; ++pos) {
+      if (!reachable[pos]) {
+        removed[pos] = true;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  // --------------------------------------------------- : Cleanup
+
+  /// Take out the removed instructions, and update jump addresses
+  void compact() {
+    // new address of each instruction, removed ones go to the next instruction that is kept
+    vector<unsigned int> new_pos(instructions.size() + 1);
+    unsigned int count = 0;
+    for (size_t pos = 0 ; pos < instructions.size() ; ++pos) {
+      new_pos[pos] = count;
+      if (!removed[pos]) ++count;
+    }
+    new_pos[instructions.size()] = count;
+    if (count == instructions.size()) return;
+    size_t out = 0;
+    for (size_t pos = 0 ; pos < instructions.size() ; ) {
+      Instruction i = instructions[pos];
+      size_t args = argument_count(i);
+      if (!removed[pos]) {
+        if (is_jump(i.instr)) i.data = new_pos[i.data];
+        instructions[out++] = i;
+        for (size_t k = 1 ; k <= args ; ++k) {
+          instructions[out++] = instructions[pos + k];
+        }
+      }
+      pos += 1 + args;
+    }
+    assert(out == count);
+    instructions.resize(out);
+  }
+
+  /// Remove constants that are no longer used, the results of folding replace the operands
+  void removeUnusedConstants() {
+    vector<unsigned int> new_index(constants.size(), (unsigned int)-1);
+    vector<ScriptValueP> used;
+    for (size_t pos = 0 ; pos < instructions.size() ; pos += 1 + argument_count(instructions[pos])) {
+      Instruction& i = instructions[pos];
+      if (i.instr != I_PUSH_CONST && i.instr != I_MEMBER_C) continue;
+      if (new_index[i.data] == (unsigned int)-1) {
+        new_index[i.data] = (unsigned int)used.size();
+        used.push_back(constants[i.data]);
+      }
+      i.data = new_index[i.data];
+    }
+    swap(constants, used);
+  }
+};
+
+// ----------------------------------------------------------------------------- : optimize_script
+
+void optimize_script(Script& script) {
+  // first the functions inside this script
+  FOR_EACH(c, script.getConstants()) {
+    if (Script* function = dynamic_cast<Script*>(c.get())) {
+      optimize_script(*function);
+    }
+  }
+  ScriptOptimizer(script).optimize();
+}
@@ -0,0 +1,32 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <script/script.hpp>
+
+// ----------------------------------------------------------------------------- : Optimizer
+
+/// Should parsed scripts be optimized? Enabled by default, disabled with --no-script-optimization
+extern bool script_optimization_enabled;
+
+/// Optimize a parsed script, and all functions ({...} blocks) that it contains
+/** Performs:
+ *   - constant folding of simple instructions (operators, rgb, rgba, min, max) with constant operands
+ *   - removal of branches with a constant condition, and of unreachable code
+ *   - jump threading, jumps to jumps go directly to the final target
+ *   - peephole optimizations, such as removing values that are pushed and immediately popped
+ *
+ *  The optimized script gives the same results as the original, and has the same stack effect at every jump target,
+ *  so dependency analysis and error backtraces keep working.
+ *
+ *  Calls to builtin functions are not folded, because their names are normal variables,
+ *  that can be changed by the script itself or by closures (such as f@(to_upper:to_lower)).
+ */
+void optimize_script(Script& script);
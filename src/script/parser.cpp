@@ -10,6 +10,7 @@
 #include <script/script.hpp>
 #include <script/parser.hpp>
 #include <script/to_value.hpp>
+#include <script/optimizer.hpp>
 #include <util/error.hpp>
 #include <util/tagged_string.hpp>
 #include <util/io/package_manager.hpp> // for "include file" semi hack
@@ -416,6 +417,7 @@ ScriptP parse(const String& s, Packaged* package, bool string_mode, vector<Scrip
   if (type == EXPR_FAILED) {
     return ScriptP();
   } else {
+    if (script_optimization_enabled) optimize_script(*script);
     return script;
   }
 }
@@ -8,18 +8,29 @@
 
 #include <util/prec.hpp>
 #include <script/profiler.hpp>
+#include <data/field.hpp>
+#include <data/card.hpp>
+#include <data/stylesheet.hpp>
+#include <util/error.hpp>
+#include <wx/wfstream.h>
+#include <wx/txtstrm.h>
+#include <mutex>
 
 #if USE_SCRIPT_PROFILING
 
-// don't use script profiling in final build
-#ifndef UNICODE
-  #error "It looks like you are building the final release; disable USE_SCRIPT_PROFILING!"
-#endif
+/// Protects the profile tree and the trace, scripts can be run from multiple threads
+static std::mutex profile_mutex;
+
+// ----------------------------------------------------------------------------- : Enabling
+
+void set_profiling_enabled(bool enabled) {
+  script_profiling_enabled = enabled;
+}
 
 // ----------------------------------------------------------------------------- : Timer
 
 Timer::Timer() {
-  start = timer_now() + delta;
+  start = profiling_enabled() ? timer_now() + delta : 0;
 }
 
 ProfileTime Timer::time() {
@@ -35,7 +46,7 @@ void Timer::exclude_time() {
   start -= delta_delta;
 }
 
-ProfileTime Timer::delta = 0;
+thread_local ProfileTime Timer::delta = 0;
 
 // ----------------------------------------------------------------------------- : FunctionProfile
 
@@ -61,8 +72,10 @@ void profile_aggregate(FunctionProfile& parent, int level, int max_level, size_t
   if (!fpp) {
     fpp = make_intrusive<FunctionProfile>(p.name);
   }
-  fpp->time_ticks += p.time_ticks;
-  fpp->calls      += p.calls;
+  fpp->time_ticks  += p.time_ticks;
+  fpp->calls       += p.calls;
+  fpp->allocations += p.allocations;
+  fpp->memo_hits   += p.memo_hits;
   // recurse
   if (level == 0) {
     profile_aggregate(parent, level, max_level, p);
@@ -78,27 +91,59 @@ void profile_aggregate(FunctionProfile& parent, int level, int max_level, const
 }
 
 const FunctionProfile& profile_aggregated(int max_level) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
   profile_aggr.children.clear();
   profile_aggregate(profile_aggr, 0, max_level, profile_root);
   return profile_aggr;
 }
 
+// ----------------------------------------------------------------------------- : Trace data
+
+/// A single profiled call
+struct TraceEvent {
+  const FunctionProfile* function;
+  ProfileTime start, duration;
+  size_t      allocations;
+  int         thread;
+  int         attribution; ///< index in trace_attributions, or -1
+};
+/// What a call was done for
+struct TraceAttribution {
+  String field, card, stylesheet;
+};
+
+/// Don't let traces grow without bound
+const size_t MAX_TRACE_EVENTS = 4000000;
+
+static atomic<bool>             trace_recording(false);
+static ProfileTime              trace_start_time = 0;
+static vector<TraceEvent>       trace_events;
+static vector<TraceAttribution> trace_attributions;
+
+static atomic<int> last_trace_thread(0);
+static thread_local int trace_thread = ++last_trace_thread;
+
 // ----------------------------------------------------------------------------- : Profiler
 
-FunctionProfile* Profiler::function = &profile_root;
+thread_local FunctionProfile* Profiler::function = &profile_root;
 
 // Enter a function
 Profiler::Profiler(Timer& timer, Variable function_name)
   : timer(timer)
   , parent(function) // push
+  , active(profiling_enabled())
 {
+  if (!active) return;
   if ((int)function_name >= 0) {
+    std::lock_guard<std::mutex> lock(profile_mutex);
     FunctionProfileP& fpp = parent->children[(size_t)function_name << 1 | 1];
     if (!fpp) {
       fpp = make_intrusive<FunctionProfile>(variable_to_string(function_name));
     }
     function = fpp.get();
   }
+  start_time = timer_now();
+  start_allocations = script_value_allocations;
   timer.exclude_time();
 }
 
@@ -106,12 +151,19 @@ Profiler::Profiler(Timer& timer, Variable function_name)
 Profiler::Profiler(Timer& timer, const Char* function_name)
   : timer(timer)
   , parent(function) // push
+  , active(profiling_enabled())
 {
-  FunctionProfileP& fpp = parent->children[(size_t)function_name];
-  if (!fpp) {
-    fpp = make_intrusive<FunctionProfile>(function_name);
+  if (!active) return;
+  {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    FunctionProfileP& fpp = parent->children[(size_t)function_name];
+    if (!fpp) {
+      fpp = make_intrusive<FunctionProfile>(function_name);
+    }
+    function = fpp.get();
   }
-  function = fpp.get();
+  start_time = timer_now();
+  start_allocations = script_value_allocations;
   timer.exclude_time();
 }
 
@@ -119,24 +171,127 @@ Profiler::Profiler(Timer& timer, const Char* function_name)
 Profiler::Profiler(Timer& timer, void* function_object, const String& function_name)
   : timer(timer)
   , parent(function) // push
+  , active(profiling_enabled())
 {
-  FunctionProfileP& fpp = parent->children[(size_t)function_object];
-  if (!fpp) {
-    fpp = make_intrusive<FunctionProfile>(function_name);
+  if (!active) return;
+  {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    FunctionProfileP& fpp = parent->children[(size_t)function_object];
+    if (!fpp) {
+      fpp = make_intrusive<FunctionProfile>(function_name);
+    }
+    function = fpp.get();
   }
-  function = fpp.get();
+  start_time = timer_now();
+  start_allocations = script_value_allocations;
   timer.exclude_time();
 }
 
 // Leave a function
 Profiler::~Profiler() {
+  if (!active) return;
   ProfileTime time = timer.time();
   if (function == parent) return; // don't count
-  function->time_ticks += time;
-  function->time_ticks_max = max(function->time_ticks_max,time);
-  function->calls      += 1;
+  size_t allocations = script_value_allocations - start_allocations;
+  {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    function->time_ticks += time;
+    function->time_ticks_max = max(function->time_ticks_max,time);
+    function->calls      += 1;
+    function->allocations += allocations;
+    if (trace_recording && trace_events.size() < MAX_TRACE_EVENTS) {
+      TraceEvent e = { function, start_time - trace_start_time, time, allocations, trace_thread, ProfileAttribution::current };
+      trace_events.push_back(e);
+    }
+  }
   function = parent; // pop
 }
 
+void Profiler::countMemoHit() {
+  if (!profiling_enabled()) return;
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  function->memo_hits += 1;
+}
+
+// ----------------------------------------------------------------------------- : Attribution
+
+thread_local int ProfileAttribution::current = -1;
+
+ProfileAttribution::ProfileAttribution(const Field* field, const Card* card, const StyleSheet* stylesheet)
+  : parent(current)
+{
+  if (!trace_recording) return;
+  TraceAttribution a;
+  if (field)      a.field      = field->name;
+  if (card)       a.card       = card->identification();
+  if (stylesheet) a.stylesheet = stylesheet->name();
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  current = (int)trace_attributions.size();
+  trace_attributions.push_back(a);
+}
+
+ProfileAttribution::~ProfileAttribution() {
+  current = parent;
+}
+
+// ----------------------------------------------------------------------------- : Trace
+
+void profile_trace_start() {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  trace_events.clear();
+  trace_attributions.clear();
+  trace_start_time = timer_now();
+  trace_recording = true;
+  set_profiling_enabled(true);
+}
+
+void profile_trace_stop() {
+  trace_recording = false;
+}
+
+bool profile_tracing() {
+  return trace_recording;
+}
+
+// Quote a string for use in json
+static String json_quote(const String& str) {
+  String ret = _("\"");
+  for (size_t i = 0 ; i < str.size() ; ++i) {
+    Char c = str.GetChar(i);
+    if      (c == _('"'))  ret += _("\\\"");
+    else if (c == _('\\')) ret += _("\\\\");
+    else if (c == _('\n')) ret += _("\\n");
+    else if (c < 0x20)     ret += String::Format(_("\\u%04x"), (int)c);
+    else                   ret += c;
+  }
+  return ret + _("\"");
+}
+
+void profile_trace_write(const String& filename) {
+  wxFileOutputStream file(filename);
+  if (!file.IsOk()) throw Error(_("Unable to write profiler trace to: ") + filename);
+  wxTextOutputStream stream(file, wxEOL_UNIX, wxConvUTF8);
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  stream << _("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  double us = 1e6 / timer_resolution();
+  bool first = true;
+  FOR_EACH_CONST(e, trace_events) {
+    if (!first) stream << _(",\n");
+    first = false;
+    stream << String::Format(_("{\"ph\":\"X\",\"cat\":\"script\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":"),
+                             e.thread, e.start * us, e.duration * us);
+    stream << json_quote(e.function->name);
+    stream << String::Format(_(",\"args\":{\"allocations\":%lu"), (unsigned long)e.allocations);
+    if (e.attribution >= 0) {
+      const TraceAttribution& a = trace_attributions[e.attribution];
+      if (!a.field.empty())      stream << _(",\"field\":")      << json_quote(a.field);
+      if (!a.card.empty())       stream << _(",\"card\":")       << json_quote(a.card);
+      if (!a.stylesheet.empty()) stream << _(",\"stylesheet\":") << json_quote(a.stylesheet);
+    }
+    stream << _("}}");
+  }
+  stream << _("\n]}\n");
+}
+
 // ----------------------------------------------------------------------------- : EOF
 #endif
@@ -11,14 +11,30 @@
 #include <util/prec.hpp>
 #include <script/script.hpp>
 #include <script/context.hpp>
+#include <chrono>
 
-#if !defined(USE_SCRIPT_PROFILING) && defined(_DEBUG)
+// Profiling is compiled into all builds, but it only records anything when enabled at runtime.
+// Define USE_SCRIPT_PROFILING as 0 to leave it out entirely.
+#if !defined(USE_SCRIPT_PROFILING)
 #define USE_SCRIPT_PROFILING 1
 #endif
 
 #if USE_SCRIPT_PROFILING
 
 DECLARE_POINTER_TYPE(FunctionProfile);
+class Field;
+class Card;
+class StyleSheet;
+
+// ----------------------------------------------------------------------------- : Enabling
+
+/// Is the profiler recording?
+/** By default profiling is only enabled in debug builds */
+inline bool profiling_enabled() {
+  return script_profiling_enabled.load(memory_order_relaxed);
+}
+/// Turn the profiler on or off
+void set_profiling_enabled(bool enabled);
 
 // ----------------------------------------------------------------------------- : Timer
 
@@ -40,15 +56,14 @@ DECLARE_POINTER_TYPE(FunctionProfile);
     return t.raw_name();
   }
 #else
-  // clock() has nanosecond resolution on Linux
-  // on any other platform, stil the best way.
-  typedef clock_t ProfileTime;
+  // steady_clock is monotonic wall clock time, unlike clock() which measures cpu time
+  typedef long long ProfileTime;
 
   inline ProfileTime timer_now() {
-    return clock();
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
   }
   inline ProfileTime timer_resolution() {
-    return CLOCKS_PER_SEC;
+    return 1000000000;
   }
 
   inline const char * mangled_name(const type_info& t) {
@@ -66,7 +81,7 @@ public:
   inline void exclude_time();
 private:
   ProfileTime start;
-  static ProfileTime delta; ///< Time excluded
+  static thread_local ProfileTime delta; ///< Time excluded
 };
 
 // ----------------------------------------------------------------------------- : FunctionProfile
@@ -75,13 +90,15 @@ private:
 class FunctionProfile : public IntrusivePtrBase<FunctionProfile> {
 public:
   FunctionProfile(const String& name)
-    : name(name), time_ticks(0), time_ticks_max(0), calls(0)
+    : name(name), time_ticks(0), time_ticks_max(0), calls(0), allocations(0), memo_hits(0)
   {}
 
   String      name;
   ProfileTime time_ticks;
   ProfileTime time_ticks_max;
   int         calls;
+  size_t      allocations; ///< Number of ScriptValues created (including in children)
+  int         memo_hits;   ///< Number of calls that were answered from the memo cache
   
   /// for each id, called children
   /** we (ab)use the fact that all pointers are even to store both pointers and ids */
@@ -94,6 +111,7 @@ public:
   inline double total_time() const { return time_ticks / (double)timer_resolution(); }
   inline double avg_time() const { return total_time() / calls; }
   inline double max_time() const { return time_ticks_max / (double)timer_resolution(); }
+  inline double avg_allocations() const { return allocations / (double)calls; }
 };
 
 /// The root profile
@@ -118,24 +136,61 @@ public:
   Profiler(Timer& timer, void* function_object, const String& function_name);
   /// Log the fact that the function is left
   ~Profiler();
+  /// Log the fact that the current call was answered from the memo cache, see Context::evalFunction
+  static void countMemoHit();
 private:
   Timer&                  timer;
-  static FunctionProfile* function; ///< function we are in
+  static thread_local FunctionProfile* function; ///< function we are in
   FunctionProfile*        parent;
+  bool                    active;            ///< Was profiling enabled when we started?
+  ProfileTime             start_time;        ///< Start time, for the trace
+  size_t                  start_allocations; ///< Value of script_value_allocations when we started
 };
 
 // Profile the current function (all following code in the current block) under the given name
 #define PROFILER(name) \
   Timer profile_timer; \
   Profiler profiler(profile_timer, name)
+// Profile under a name that is only constructed when profiling is enabled
 #define PROFILER2(name1,name2) \
   Timer profile_timer; \
-  Profiler profiler(profile_timer, name1,name2)
+  Profiler profiler(profile_timer, name1, profiling_enabled() ? String(name2) : String())
+
+// ----------------------------------------------------------------------------- : Attribution
+
+/// Attribute everything profiled in the current scope (on this thread) to a field of a card or set
+/** Only has an effect on traces, see profile_trace_start */
+class ProfileAttribution {
+public:
+  ProfileAttribution(const Field* field, const Card* card, const StyleSheet* stylesheet);
+  ~ProfileAttribution();
+private:
+  int parent; ///< previous attribution
+  static thread_local int current;
+  friend class Profiler;
+};
+
+#define PROFILE_ATTRIBUTION(field, card, stylesheet) \
+  ProfileAttribution profile_attribution(field, card, stylesheet)
+
+// ----------------------------------------------------------------------------- : Trace
+
+/// Start recording a trace of every profiled call.
+/** Also enables profiling. Any previously recorded trace is discarded. */
+void profile_trace_start();
+/// Stop recording a trace
+void profile_trace_stop();
+/// Is a trace being recorded?
+bool profile_tracing();
+/// Write the recorded trace to a file.
+/** Uses the Chrome trace event format, which can be viewed with chrome://tracing or https://ui.perfetto.dev */
+void profile_trace_write(const String& filename);
 
 #else // USE_SCRIPT_PROFILING
 
 #define PROFILER(a)
 #define PROFILER2(a,b)
+#define PROFILE_ATTRIBUTION(a,b,c)
 
 #endif // USE_SCRIPT_PROFILING
 
@@ -174,6 +174,12 @@ void SetScriptManager::onAction(const Action& action, bool undone) {
       updateValue(*action.valueP, CardP());
     }
   }
+  TYPE_CASE(action, ReplaceAllAction) {
+    FOR_EACH_CONST(a, action.actions) {
+      updateValue(*a->valueP, a->card);
+    }
+    return;
+  }
   TYPE_CASE_(action, ScriptValueEvent) {
     return; // Don't go into an infinite loop because of our own events
   }
@@ -220,6 +226,7 @@ void SetScriptManager::updateStyles(const CardP& card, bool only_content_depende
   assert(card);
   const StyleSheet& stylesheet = set.stylesheetFor(card);
   Context& ctx = getContext(card);
+  PROFILE_ATTRIBUTION(nullptr, card.get(), &stylesheet);
   if (!only_content_dependent) {
     // update extra card fields
     IndexMap<FieldP,ValueP>& extra_data = card->extraDataFor(stylesheet);
@@ -283,6 +290,7 @@ void SetScriptManager::updateAll() {
   FOR_EACH(v, set.data) {
     try {
       PROFILER2( v->fieldP.get(), _("update set.") + v->fieldP->name );
+      PROFILE_ATTRIBUTION(v->fieldP.get(), nullptr, set.stylesheet.get());
       v->update(ctx);
     } catch (const ScriptError& e) {
       handle_error(ScriptError(e.what() + _("\n  while updating set value '") + v->fieldP->name + _("'")));
@@ -293,10 +301,8 @@ void SetScriptManager::updateAll() {
     Context& ctx = getContext(card);
     FOR_EACH(v, card->data) {
       try {
-        #if USE_SCRIPT_PROFILING
-          Timer t;
-          Profiler prof(t, v->fieldP.get(), _("update card.") + v->fieldP->name);
-        #endif
+        PROFILER2( v->fieldP.get(), _("update card.") + v->fieldP->name );
+        PROFILE_ATTRIBUTION(v->fieldP.get(), card.get(), &set.stylesheetFor(card));
         v->update(ctx);
       } catch (const ScriptError& e) {
         handle_error(ScriptError(e.what() + _("\n  while updating card value '") + v->fieldP->name + _("'")));
@@ -332,6 +338,7 @@ void SetScriptManager::updateToUpdate(const ToUpdate& u, deque<ToUpdate>& to_upd
   Context& ctx = getContext(u.card);
   bool changes = false;
   try {
+    PROFILE_ATTRIBUTION(u.value->fieldP.get(), u.card.get(), &set.stylesheetFor(u.card));
     changes = u.value->update(ctx);
   } catch (const ScriptError& e) {
     handle_error(ScriptError(e.what() + _("\n  while updating value '") + u.value->fieldP->name + _("'")));
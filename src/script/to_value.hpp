@@ -266,11 +266,12 @@ public:
   GeneratedImageP toImage() const override {
     ScriptValueP d = getDefault(); return d ? d->toImage() : ScriptValue::toImage();
   }
+  /// Objects with a simple default member, such as text values, can be used as that member
+  bool appendMemoKey(String& key) const override {
+    ScriptValueP d = getDefault(); return d && d->appendMemoKey(key);
+  }
   ScriptValueP getMember(const String& name) const override {
-    #if USE_SCRIPT_PROFILING
-      Timer t;
-      Profiler prof(t, (void*)mangled_name(typeid(T)), _("get member of ") + type_name(*value));
-    #endif
+    PROFILER2((void*)mangled_name(typeid(T)), _("get member of ") + type_name(*value));
     // Use reflection to find the member of the object
     GetMember gm(name);
     gm.handle(*value);
@@ -342,7 +343,7 @@ public:
   ScriptValueP dependencies(Context& ctx, const Dependency& dep) const override;
 
   /// Add a binding
-  void addBinding(Variable v, const ScriptValueP& value);
+  void addBinding(Variable v, ScriptValueP value);
   /// Is there a binding for the given variable? If so, retrieve it
   ScriptValueP getBinding(Variable v) const;
 
@@ -13,11 +13,17 @@
 #include <script/context.hpp>
 #include <gfx/generated_image.hpp>
 #include <util/error.hpp>
-#include <boost/pool/singleton_pool.hpp>
 
 // ----------------------------------------------------------------------------- : ScriptValue
 // Base cases
 
+#ifdef _DEBUG
+  atomic<bool> script_profiling_enabled(true);
+#else
+  atomic<bool> script_profiling_enabled(false);
+#endif
+thread_local size_t script_value_allocations = 0;
+
 String ScriptValue::toString() const {
   throw ScriptErrorConversion(typeName(), _TYPE_("string"));
 }
@@ -77,6 +83,12 @@ ScriptValueP ScriptValue::getIndex(int index) const {
 ScriptValueP ScriptValue::simplifyClosure(ScriptClosure&) const {
   return nullptr;
 }
+bool ScriptValue::memoKey(Context&, String&) const {
+  return false;
+}
+bool ScriptValue::appendMemoKey(String&) const {
+  return false;
+}
 
 ScriptValueP ScriptValue::dependencyMember(const String& name, const Dependency&) const {
   return dependency_dummy;
@@ -211,10 +223,6 @@ ScriptValueP rangeIterator(int start, int end) {
 
 // ----------------------------------------------------------------------------- : Integers
 
-#if defined(USE_INTRUSIVE_PTR) && !defined(USE_POOL_ALLOCATOR)
-  #define USE_POOL_ALLOCATOR 0 // disabled by default
-#endif
-
 // Integer values
 class ScriptInt : public ScriptValue {
 public:
@@ -224,38 +232,31 @@ public:
   String toString() const override { return String() << value; }
   double toDouble() const override { return value; }
   int toInt()       const override { return value; }
-protected:
-#if USE_POOL_ALLOCATOR
-  void destroy() const override {
-    boost::singleton_pool<ScriptValue, sizeof(ScriptInt)>::free(this);
+  bool appendMemoKey(String& key) const override {
+    key << _('i') << value << _(';');
+    return true;
   }
-#endif
 private:
   int value;
 };
 
-#if USE_POOL_ALLOCATOR && !USE_INTRUSIVE_PTR
-  // deallocation function for pool allocated integers
-  void destroy_value(ScriptInt* v) {
-    boost::singleton_pool<ScriptValue, sizeof(ScriptInt)>::free(v);
-  }
-#endif
+// Small integers are very common (counters, indices, sizes), they are shared instead of allocated every time
+const int SMALL_INT_MIN = -16;
+const int SMALL_INT_MAX = 256;
 
 ScriptValueP to_script(int v) {
-#if USE_POOL_ALLOCATOR
-  #if USE_INTRUSIVE_PTR
-    return ScriptValueP(
-        new(boost::singleton_pool<ScriptValue, sizeof(ScriptInt)>::malloc())
-          ScriptInt(v));
-  #else
-    return ScriptValueP(
-        new(boost::singleton_pool<ScriptValue, sizeof(ScriptInt)>::malloc())
-          ScriptInt(v),
-        destroy_value); // deallocation function
-  #endif
-#else
+  if (v >= SMALL_INT_MIN && v < SMALL_INT_MAX) {
+    static const vector<ScriptValueP> small_ints = []{
+      vector<ScriptValueP> ints;
+      ints.reserve(SMALL_INT_MAX - SMALL_INT_MIN);
+      for (int i = SMALL_INT_MIN ; i < SMALL_INT_MAX ; ++i) {
+        ints.push_back(make_intrusive<ScriptInt>(i));
+      }
+      return ints;
+    }();
+    return small_ints[v - SMALL_INT_MIN];
+  }
   return make_intrusive<ScriptInt>(v);
-#endif
 }
 
 // ----------------------------------------------------------------------------- : Booleans
@@ -269,13 +270,15 @@ public:
   String toString() const override { return value ? _("true") : _("false"); }
   bool toBool() const override { return value; }
   // bools don't autoconvert to int
+  bool appendMemoKey(String& key) const override {
+    key += value ? _("b1;") : _("b0;");
+    return true;
+  }
 private:
   bool value;
 };
 
-/* NOTE: previous versions used ScriptInts as booleans, this gives problems
- * when we use a pool allocator for them, because the pool is destroyed before these globals.
- */
+// NOTE: the small object pool is never destroyed, so it is safe to free these globals at exit
 ScriptValueP script_true (new ScriptBool(true));
 ScriptValueP script_false(new ScriptBool(false));
 
@@ -290,6 +293,10 @@ public:
   String toString() const override { return String() << value; }
   double toDouble() const override { return value; }
   int toInt() const override { return (int)value; }
+  bool appendMemoKey(String& key) const override {
+    key += String::Format(_("d%.17g;"), value);
+    return true;
+  }
 private:
   double value;
 };
@@ -383,6 +390,10 @@ public:
       return delay_error(_ERROR_2_("has no member value", value, name));
     }
   }
+  bool appendMemoKey(String& key) const override {
+    key << _('s') << (unsigned long)value.size() << _(':') << value;
+    return true;
+  }
 private:
   String value;
 };
@@ -405,6 +416,10 @@ public:
   String toString() const override {
     return format_color(value);
   }
+  bool appendMemoKey(String& key) const override {
+    key << _('c') << (unsigned long)value.packed << _(';');
+    return true;
+  }
 private:
   Color value;
 };
@@ -453,6 +468,10 @@ public:
   String toCode() const override {
     return "nil";
   }
+  bool appendMemoKey(String& key) const override {
+    key += _("n;");
+    return true;
+  }
   ScriptValueP eval(Context& ctx, bool) const override {
     // nil(input) == input
     return ctx.getVariable(SCRIPT_VAR_input);
@@ -581,8 +600,8 @@ String ScriptClosure::typeName() const {
   return fun->typeName() + _(" closure");
 }
 
-void ScriptClosure::addBinding(Variable v, const ScriptValueP& value) {
-  bindings.push_back(make_pair(v,value));
+void ScriptClosure::addBinding(Variable v, ScriptValueP value) {
+  bindings.push_back(make_pair(v,std::move(value)));
 }
 ScriptValueP ScriptClosure::getBinding(Variable v) const {
   FOR_EACH_CONST(b, bindings) {
@@ -598,7 +617,7 @@ ScriptValueP ScriptClosure::simplify() {
 ScriptValueP ScriptClosure::eval(Context& ctx, bool openScope) const {
   unique_ptr<LocalScope> scope = openScope ? make_unique<LocalScope>(ctx) : nullptr;
   applyBindings(ctx);
-  return fun->eval(ctx, openScope);
+  return ctx.evalFunction(*fun, openScope);
 }
 ScriptValueP ScriptClosure::dependencies(Context& ctx, const Dependency& dep) const {
   LocalScope scope(ctx);
@@ -10,6 +10,8 @@
 
 #include <util/prec.hpp>
 #include <gfx/color.hpp>
+#include <util/small_object_pool.hpp>
+#include <atomic>
 class Context;
 class Dependency;
 class ScriptClosure;
@@ -43,12 +45,36 @@ enum CompareWhat
 ,  COMPARE_AS_POINTER
 };
 
+/// Is the script profiler recording? (see script/profiler.hpp)
+extern atomic<bool>   script_profiling_enabled;
+/// Number of ScriptValues created on this thread while the profiler was recording
+extern thread_local size_t script_value_allocations;
+
+#if USE_INTRUSIVE_PTR && !defined(USE_POOL_ALLOCATOR)
+  #define USE_POOL_ALLOCATOR 1
+#endif
+
 /// A value that can be handled by the scripting engine.
 /// Actual values are derived types
 class ScriptValue : public IntrusivePtrBaseWithDelete {
 public:
+  inline ScriptValue() {
+    if (script_profiling_enabled.load(memory_order_relaxed)) {
+      ++script_value_allocations;
+    }
+  }
   virtual ~ScriptValue() {}
 
+#if USE_POOL_ALLOCATOR
+  // Script values are small and short lived, allocate them from a pool
+  static void* operator new(size_t size) {
+    return small_object_allocate(size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    small_object_free(ptr, size);
+  }
+#endif
+
   /// Information on the type of this value
   virtual ScriptType type() const = 0;
   /// Name of the type of value
@@ -97,6 +123,16 @@ public:
    *  Alternatively, the closure may be modified in place.
    */
   virtual ScriptValueP simplifyClosure(ScriptClosure&) const;
+  /// Make a memo key for a call to this function with the current parameters in ctx.
+  /** Only pure functions, whose result depends on nothing but their parameters, have a memo key.
+   *  Returns false if the call can't be memoized, see Context::evalFunction.
+   */
+  virtual bool memoKey(Context& ctx, String& key) const;
+  /// Append a representation of this value to a memo key
+  /** Values that are equal get the same representation.
+   *  Returns false for values that can't be part of a memo key, such as functions and collections.
+   */
+  virtual bool appendMemoKey(String& key) const;
 
   /// Return an iterator for the current collection, an iterator is a value that has next()
   virtual ScriptValueP makeIterator() const;
@@ -14,7 +14,11 @@
 // ----------------------------------------------------------------------------- : Action stack
 
 ActionStack::ActionStack()
-  : save_point(nullptr)
+  : bottom_id(0)
+  , next_id(1)
+  , save_point(0)
+  , memory_budget(0)
+  , memory_usage(0)
   , last_was_add(false)
 {}
 
@@ -24,40 +28,48 @@ void ActionStack::addAction(unique_ptr<Action> action, bool allow_merge) {
   tellListeners(*action, false);
   // clear redo list
   if (!redo_actions.empty()) allow_merge = false; // don't merge after undo
+  FOR_EACH_CONST(e, redo_actions) memory_usage -= e.bytes;
   redo_actions.clear();
   // try to merge?
   if (allow_merge && !undo_actions.empty() &&
-      last_was_add                            && // never merge with something that was redone once already
-      undo_actions.back().get() != save_point && // never merge with the save point
-      undo_actions.back()->merge(*action) // merged with top undo action
+      last_was_add                             && // never merge with something that was redone once already
+      undo_actions.back().id != save_point     && // never merge with the save point
+      undo_actions.back().action->merge(*action) // merged with top undo action
       ) {
-    // don't add
+    // don't add, but the merged action may have grown
+    Entry& top = undo_actions.back();
+    memory_usage -= top.bytes;
+    top.bytes = top.action->memoryUsage();
+    memory_usage += top.bytes;
   } else {
-    undo_actions.push_back(move(action));
+    size_t bytes = action->memoryUsage();
+    undo_actions.push_back(Entry{move(action), bytes, next_id++});
+    memory_usage += bytes;
   }
   last_was_add = true;
+  enforceBudget();
 }
 
 void ActionStack::undo() {
   assert(canUndo());
   if (!canUndo()) return;
-  unique_ptr<Action> action = move(undo_actions.back());
+  Entry entry = move(undo_actions.back());
   undo_actions.pop_back();
-  action->perform(true);
-  tellListeners(*action, true);
+  entry.action->perform(true);
+  tellListeners(*entry.action, true);
   // move to redo stack
-  redo_actions.emplace_back(move(action));
+  redo_actions.emplace_back(move(entry));
   last_was_add = false;
 }
 void ActionStack::redo() {
   assert(canRedo());
   if (!canRedo()) return;
-  unique_ptr<Action> action = move(redo_actions.back());
+  Entry entry = move(redo_actions.back());
   redo_actions.pop_back();
-  action->perform(false);
-  tellListeners(*action, false);
+  entry.action->perform(false);
+  tellListeners(*entry.action, false);
   // move to undo stack
-  undo_actions.emplace_back(move(action));
+  undo_actions.emplace_back(move(entry));
   last_was_add = false;
 }
 
@@ -70,28 +82,44 @@ bool ActionStack::canRedo() const {
 
 String ActionStack::undoName() const {
   if (canUndo()) {
-    return _(" ") + capitalize(undo_actions.back()->getName(true));
+    return _(" ") + capitalize(undo_actions.back().action->getName(true));
   } else {
     return wxEmptyString;
   }
 }
 String ActionStack::redoName() const {
   if (canRedo()) {
-    return _(" ") + capitalize(redo_actions.back()->getName(false));
+    return _(" ") + capitalize(redo_actions.back().action->getName(false));
   } else {
     return wxEmptyString;
   }
 }
 
 bool ActionStack::atSavePoint() const {
-  return (undo_actions.empty() && save_point == nullptr)
-      || (undo_actions.back().get() == save_point);
+  return currentId() == save_point;
 }
 void ActionStack::setSavePoint() {
-  if (undo_actions.empty()) {
-    save_point = nullptr;
-  } else {
-    save_point = undo_actions.back().get();
+  save_point = currentId();
+}
+
+void ActionStack::setMemoryBudget(size_t bytes) {
+  memory_budget = bytes;
+  enforceBudget();
+}
+
+void ActionStack::enforceBudget() {
+  if (memory_budget == 0) return;
+  // first forget the oldest undo actions, we can no longer go back to before them
+  while (memory_usage > memory_budget && undo_actions.size() > 1) {
+    Entry& e = undo_actions.front();
+    memory_usage -= e.bytes;
+    bottom_id = e.id;
+    undo_actions.pop_front();
+  }
+  // then the redo actions furthest in the future
+  while (memory_usage > memory_budget && !redo_actions.empty() && undo_actions.size() + redo_actions.size() > 1) {
+    memory_usage -= redo_actions.front().bytes;
+    redo_actions.pop_front();
   }
 }
 
@@ -11,6 +11,7 @@
 #include <util/prec.hpp>
 #include <util/string.hpp>
 #include <vector>
+#include <deque>
 
 // ----------------------------------------------------------------------------- : Action
 
@@ -40,6 +41,10 @@ public:
    *  Or: return true and change this action to incorporate both actions
    */
   virtual bool merge(const Action& action) { return false; }
+  
+  /// Approximate number of bytes used by this action, for limiting the size of the undo history
+  /** Should include data that is only kept alive by this action, such as removed cards */
+  virtual size_t memoryUsage() const { return 64; }
 };
 
 // ----------------------------------------------------------------------------- : Action listeners
@@ -96,6 +101,14 @@ public:
   /// Indicate that the file is at a savepoint.
   void setSavePoint();
   
+  /// Limit the memory used by the undo and redo history, 0 for no limit
+  /** When the limit is exceeded the oldest actions are forgotten.
+   *  The most recent action is always kept.
+   */
+  void setMemoryBudget(size_t bytes);
+  /// Approximate memory used by the actions on the stack
+  inline size_t memoryUsage() const { return memory_usage; }
+  
   /// Add an action listener
   void addListener(ActionListener* listener);
   /// Remove an action listener
@@ -104,16 +117,37 @@ public:
   void tellListeners(const Action&, bool undone);
   
 private:
+  /// An action on the stack
+  struct Entry {
+    unique_ptr<Action> action;
+    size_t             bytes; ///< memoryUsage() of the action
+    UInt               id;    ///< Identifies the state after performing the action
+  };
   /// Actions to be undone.
-  vector<unique_ptr<Action>> undo_actions;
+  deque<Entry> undo_actions;
   /// Actions to be redone
-  vector<unique_ptr<Action>> redo_actions;
+  deque<Entry> redo_actions;
+  /// Id of the state at the bottom of the undo stack, 0 is the initial state
+  /** Forgetting old actions moves the bottom up. */
+  UInt bottom_id;
+  /// Id that will be given to the next added action
+  UInt next_id;
   /// Point at which the file was saved, corresponds to the top of the undo stack at that point
-  const Action* save_point;
+  /** Ids are used instead of pointers to the actions, because actions can be forgotten */
+  UInt save_point;
+  /// Memory limit, 0 if unlimited
+  size_t memory_budget;
+  /// Sum of the memory used by all entries
+  size_t memory_usage;
   /// Was the last thing the user did addAction? (as opposed to undo/redo)
   bool last_was_add;
   /// Objects that are listening to actions
   vector<ActionListener*> listeners;
+  
+  /// Id of the current state
+  inline UInt currentId() const { return undo_actions.empty() ? bottom_id : undo_actions.back().id; }
+  /// Forget old actions until we are within budget
+  void enforceBudget();
 };
 
 
@@ -0,0 +1,62 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/find_replace.hpp>
+#include <util/tagged_string.hpp>
+
+// ----------------------------------------------------------------------------- : Search/replace
+
+bool is_word_end(const String& s, size_t pos) {
+  if (pos == 0 || pos >= s.size()) return true;
+  Char c = s.GetChar(pos);
+  return isSpace(c) || isPunct(c);
+}
+
+String FindInfo::searchString(const String& tagged) const {
+  String v = untag(tagged);
+  if (!caseSensitive()) v.LowerCase();
+  return v;
+}
+
+bool FindInfo::matchesAt(const String& s, size_t pos) const {
+  if (pos >= s.size()) return false;
+  if (wholeWord()) {
+    if (!is_word_end(s, pos - 1) || !is_word_end(s, pos + findString().size())) return false;
+  }
+  if (caseSensitive()) {
+    return is_substr(s, pos, findString());
+  } else {
+    return is_substr(s, pos, findString().Lower());
+  }
+}
+
+String FindInfo::replaceAll(const String& tagged) const {
+  size_t len = findString().size();
+  if (len == 0) return tagged;
+  // find the matches, they don't overlap
+  String s = searchString(tagged);
+  vector<size_t> matches;
+  for (size_t i = 0 ; i + len <= s.size() ; ) {
+    if (matchesAt(s, i)) {
+      matches.push_back(i);
+      i += len;
+    } else {
+      ++i;
+    }
+  }
+  // replace from the end, so the untagged positions of earlier matches stay the same
+  String result = tagged;
+  String replacement = escape(what.GetReplaceString());
+  FOR_EACH_REVERSE(pos, matches) {
+    size_t start = untagged_to_index(result, pos,       true);
+    size_t end   = untagged_to_index(result, pos + len, true);
+    result = tagged_substr_replace(result, start, end, replacement);
+  }
+  return result;
+}
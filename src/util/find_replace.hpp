@@ -39,6 +39,13 @@ public:
   /// String to look for
   inline const String& findString() const { return what.GetFindString(); }
   
+  /// The string to search in for a tagged value: untagged, and in lower case unless the search is case sensitive
+  String searchString(const String& tagged) const;
+  /// Is findString() at position pos of s? s should be a searchString()
+  bool matchesAt(const String& s, size_t pos) const;
+  /// Replace all matches in a tagged value by the replace string
+  String replaceAll(const String& tagged) const;
+  
 protected:
   wxFindReplaceData& what; ///< What to search for, the direction to search in
 };
@@ -14,6 +14,7 @@
 #include <script/profiler.hpp> // for PROFILER
 #include <wx/wfstream.h>
 #include <wx/zipstrm.h>
+#include <wx/mstream.h>
 #include <wx/dir.h>
 
 // ----------------------------------------------------------------------------- : Package : outside
@@ -23,6 +24,8 @@ IMPLEMENT_DYNAMIC_ARG(Package*, clipboard_package, nullptr);
 
 Package::Package()
   : zipStream (nullptr)
+  , contents_pending(false)
+  , contents_fast(false)
 {}
 
 Package::~Package() {
@@ -61,8 +64,12 @@ const String& Package::absoluteFilename() const {
 }
 
 void Package::open(const String& n, bool fast) {
+  openLazily(n, fast);
+  requireContents();
+}
+
+void Package::openLazily(const String& n, bool fast) {
   assert(!isOpened()); // not already opened
-  PROFILER(_("open package"));
   // get absolute path
   wxFileName fn(n);
   fn.Normalize();
@@ -71,14 +78,29 @@ void Package::open(const String& n, bool fast) {
   if (!fn.FileExists() || !fn.GetTimes(0, &modified, 0)) {
     modified = wxDateTime(0.0); // long time ago
   }
+  if (!wxDirExists(filename) && !wxFileExists(filename)) {
+    throw PackageNotFoundError(_("Package not found: '") + filename + _("'"));
+  }
+  // the contents are read by requireContents
+  contents_pending = true;
+  contents_fast    = fast;
+}
+
+void Package::requireContents() const {
+  wxMutexLocker lock(contents_mutex);
+  if (!contents_pending) return;
+  PROFILER(_("open package"));
+  // reading the contents doesn't change the package as seen from the outside
+  Package* that = const_cast<Package*>(this);
   // type of package
   if (wxDirExists(filename)) {
-    openDirectory(fast);
+    that->openDirectory(contents_fast);
   } else if (wxFileExists(filename)) {
-    openZipfile();
+    that->openZipfile();
   } else {
     throw PackageNotFoundError(_("Package not found: '") + filename + _("'"));
   }
+  that->contents_pending = false;
 }
 
 void Package::reopen() {
@@ -98,6 +120,7 @@ void Package::save(bool remove_unused) {
 }
 
 void Package::saveAs(const String& name, bool remove_unused, bool as_directory) {
+  requireContents();
   // type of package
   if (wxDirExists(name) || as_directory) {
     saveToDirectory(name, remove_unused, false);
@@ -110,6 +133,7 @@ void Package::saveAs(const String& name, bool remove_unused, bool as_directory)
 }
 
 void Package::saveCopy(const String& name) {
+  requireContents();
   saveToZipfile(name, true, true);
   clearKeepFlag();
 }
@@ -192,6 +216,7 @@ unique_ptr<wxInputStream> Package::openIn(const String& file) {
     Packaged* p = dynamic_cast<Packaged*>(this);
     return package_manager.openFileFromPackage(p, file).first;
   }
+  requireContents();
   FileInfos::iterator it = files.find(normalize_internal_filename(file));
   if (it == files.end()) {
     // does it look like a relative filename?
@@ -220,12 +245,25 @@ unique_ptr<wxInputStream> Package::openIn(const String& file) {
   }
 }
 
+DateTime Package::fileModificationTime(const String& file) const {
+  requireContents();
+  FileInfos::const_iterator it = files.find(normalize_internal_filename(file));
+  if (it == files.end()) {
+    return DateTime((wxLongLong)0ul);
+  } else if (it->second.wasWritten()) {
+    return wxFileName(it->second.tempName).GetModificationTime();
+  } else {
+    return modificationTime(*it);
+  }
+}
+
 unique_ptr<wxOutputStream> Package::openOut(const String& file) {
   return make_unique<wxFileOutputStream>(nameOut(file));
 }
 
 String Package::nameOut(const String& file) {
   assert(wxThread::IsMain()); // Writing should only be done from the main thread
+  requireContents();
   String name = normalize_internal_filename(file);
   FileInfos::iterator it = files.find(name);
   if (it == files.end()) {
@@ -247,6 +285,7 @@ String Package::nameOut(const String& file) {
 
 LocalFileName Package::newFileName(const String& prefix, const String& suffix) {
   assert(wxThread::IsMain()); // Writing should only be done from the main thread
+  requireContents();
   String name;
   UInt infix = 0;
   while (true) {
@@ -268,6 +307,7 @@ LocalFileName Package::newFileName(const String& prefix, const String& suffix) {
 
 void Package::referenceFile(const String& file) {
   if (file.empty()) return;
+  requireContents();
   FileInfos::iterator it = files.find(file);
   if (it == files.end()) throw InternalError(_("referencing a nonexistant file"));
   it->second.keep = true;
@@ -277,6 +317,7 @@ void Package::referenceFile(const String& file) {
 
 String Package::absoluteName(const LocalFileName& file) {
   assert(wxThread::IsMain());
+  requireContents();
   FileInfos::iterator it = files.find(normalize_internal_filename(file.fn));
   if (it == files.end()) {
     throw FileNotFoundError(file.fn, filename);
@@ -549,6 +590,7 @@ IMPLEMENT_REFLECTION(Packaged) {
 Packaged::Packaged()
   : position_hint(100000)
   , fully_loaded(true)
+  , preloaded(false)
 {}
 
 unique_ptr<wxInputStream> Packaged::openIconFile() {
@@ -569,10 +611,15 @@ template <> void Reader::handle(JustAsPackageProxy& object) {
 }
 
 void Packaged::open(const String& package, bool just_header) {
-  Package::open(package);
   fully_loaded = false;
   PROFILER(just_header ? _("open package header") : _("open package fully"));
   if (just_header) {
+    // The zip file/directory is only read once a file inside it is needed,
+    // the header is often remembered from a previous run
+    openLazily(package);
+    time_t data_modified; wxUint64 data_size;
+    dataFileStamp(data_modified, data_size);
+    if (package_manager.header_snapshot.restoreHeader(*this, data_modified, data_size)) return;
     // Read just the header (the part common to all Packageds)
     auto stream = openIn(typeName());
     Reader reader(*stream, this, absoluteFilename() + _("/") + typeName(), true);
@@ -582,15 +629,41 @@ void Packaged::open(const String& package, bool just_header) {
     } catch (const ParseError& err) {
       throw FileParseError(err.what(), absoluteFilename() + _("/") + typeName()); // more detailed message
     }
+    package_manager.header_snapshot.storeHeader(*this, data_modified, data_size);
   } else {
+    Package::open(package);
     loadFully();
   }
 }
 
+void Packaged::openForLoading(const String& package) {
+  fully_loaded = false;
+  Package::open(package);
+  time_t data_modified; wxUint64 data_size;
+  dataFileStamp(data_modified, data_size);
+  package_manager.header_snapshot.restoreHeader(*this, data_modified, data_size);
+}
+
+void Packaged::dataFileStamp(time_t& data_modified, wxUint64& data_size) const {
+  String data_file = wxDirExists(absoluteFilename()) ? absoluteFilename() + _("/") + typeName() : absoluteFilename();
+  data_modified = file_modified_time(data_file);
+  wxULongLong size = wxFileName::GetSize(data_file);
+  data_size = size == wxInvalidSize ? 0 : size.GetValue();
+}
+
 void Packaged::loadFully() {
   if (fully_loaded) return;
-  auto stream = openIn(typeName());
+  unique_ptr<wxInputStream> stream;
+  if (preloaded) {
+    stream = make_unique<wxMemoryInputStream>(preloaded_data.data(), preloaded_data.size());
+  } else {
+    stream = openIn(typeName());
+  }
   Reader reader(*stream, this, absoluteFilename() + _("/") + typeName());
+  preloaded = false;
+  std::string().swap(preloaded_data);
+  // the header may already have been read, reading a vector appends to it
+  dependencies.clear();
   try {
     reader.handle_greedy(*this);
     fully_loaded = true; // only after loading and validating succeeded, be careful with recursion!
@@ -599,6 +672,21 @@ void Packaged::loadFully() {
   }
 }
 
+void Packaged::preload() {
+  if (fully_loaded || preloaded) return;
+  try {
+    auto stream = openIn(typeName());
+    char chunk[16384];
+    while (stream->Read(chunk, sizeof(chunk)).LastRead() > 0) {
+      preloaded_data.append(chunk, stream->LastRead());
+    }
+    preloaded = !preloaded_data.empty();
+  } catch (const Error&) {
+    // loadFully will try again, and report the error
+    preloaded_data.clear();
+  }
+}
+
 void Packaged::save() {
   WITH_DYNAMIC_ARG(writing_package, this);
   writeFile(typeName(), *this, fileVersion());
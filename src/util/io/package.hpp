@@ -100,7 +100,7 @@ public:
   /// Return the absolute filename of this file
   const String& absoluteFilename() const;
   /// The time this package was last modified
-  inline wxDateTime lastModified() const { return modified; }
+  inline wxDateTime lastModified() const { requireContents(); return modified; }
 
   /// Open a package
   /**
@@ -132,6 +132,9 @@ public:
 
   // --------------------------------------------------- : Managing the inside of the package
 
+  /// The time a file in the package was last modified, or 0 if it is not known
+  DateTime fileModificationTime(const String& file) const;
+
   /// Open an input stream for a file in the package.
   unique_ptr<wxInputStream> openIn(const String& file);
   inline unique_ptr<wxInputStream> openIn(const LocalFileName& file) {
@@ -185,6 +188,12 @@ protected:
   // TODO: I dislike putting this here very much. There ought to be a better way.
   virtual VCSP getVCS() { return make_intrusive<VCS>(); }
 
+  /// Open a package, but don't look inside it yet
+  /** The zip file or directory is only read when a file in the package is first needed.
+   *  Throws PackageNotFoundError just like open() when the package doesn't exist.
+   */
+  void openLazily(const String& package, bool fast = false);
+
   /// true if this is a zip file, false if a directory
   bool isZipfile() const { return !wxDirExists(filename); }
 
@@ -211,7 +220,7 @@ protected:
 public:
   /// Information on files in the package
   typedef map<String, FileInfo> FileInfos;
-  inline const FileInfos& getFileInfos() const { return files; }
+  inline const FileInfos& getFileInfos() const { requireContents(); return files; }
   /// When was a file last modified?
   DateTime modificationTime(const pair<String, FileInfo>& fi) const;
 private:
@@ -219,6 +228,15 @@ private:
   FileInfos files;
   /// Filestream/zipstream for reading zip files
   unique_ptr<wxZipInputStream> zipStream;
+  /// Has the package been opened with openLazily, without reading the zip file/directory yet?
+  bool contents_pending;
+  /// Should openDirectory skip the full directory listing?
+  bool contents_fast;
+  /// Protects contents_pending, so the package is opened once when used from multiple threads
+  mutable wxMutex contents_mutex;
+
+  /// Read the zip file/directory if that was deferred by openLazily
+  void requireContents() const;
 
   void loadZipStream();
   void openDirectory(bool fast = false);
@@ -276,8 +294,18 @@ public:
   /** if just_header is true, then the package is not fully parsed.
    */
   void open(const String& package, bool just_header = false);
+  /// Open a package that is going to be loaded with loadFully()
+  /** The header is only restored if it is remembered from a previous run, so the dependencies can be known
+   *  before loading, but the data file is not parsed twice.
+   */
+  void openForLoading(const String& package);
   /// Ensure the package is fully loaded.
   void loadFully();
+  /// Read the data file into memory, so a later loadFully() doesn't have to wait for the disk
+  /** Can be used from a worker thread, as long as the package is not used by another thread at the same time.
+   *  Errors are ignored here, they are reported by loadFully().
+   */
+  void preload();
   void save();
   void saveAs(const String& package, bool remove_unused = true, bool as_directory = false);
   void saveCopy(const String& package);
@@ -303,6 +331,10 @@ protected:
   
 private:
   bool   fully_loaded;  ///< Is the package fully loaded?
+  std::string preloaded_data; ///< Contents of the data file, read by preload()
+  bool   preloaded;     ///< Has the data file been preloaded?
+  /// Modification time and size of the data file, these identify the header in the snapshot
+  void dataFileStamp(time_t& data_modified, wxUint64& data_size) const;
   friend struct JustAsPackageProxy;
   friend class Installer;
 };
@@ -10,6 +10,7 @@
 #include <util/io/package_manager.hpp>
 #include <util/error.hpp>
 #include <util/file_utils.hpp>
+#include <script/profiler.hpp>
 #include <data/game.hpp>
 #include <data/stylesheet.hpp>
 #include <data/symbol_font.hpp>
@@ -18,12 +19,18 @@
 #include <data/installer.hpp>
 #include <wx/stdpaths.h>
 #include <wx/wfstream.h>
+#include <wx/thread.h>
+#include <exception>
+#include <functional>
+#include <atomic>
 
 // ----------------------------------------------------------------------------- : PackageManager : in memory
 
 PackageManager package_manager;
 
 
+String image_cache_dir();
+
 void PackageManager::init() {
   local.init(true);
   global.init(false);
@@ -31,13 +38,22 @@ void PackageManager::init() {
     throw Error(_("The MSE data files can not be found, there should be a directory called 'data' with these files. ")
                 _("The expected place to find it in was either ") + wxStandardPaths::Get().GetDataDir() + _(" or ") +
                 wxStandardPaths::Get().GetUserDataDir());
+  header_snapshot.load(image_cache_dir() + _("package-headers.snapshot"));
 }
 void PackageManager::destroy() {
   loaded_packages.clear();
+  header_snapshot.save();
 }
 void PackageManager::reset() {
   loaded_packages.clear();
 }
+void PackageManager::setLocalDirectory(const String& dir) {
+  local.init(dir);
+  if (!local.valid()) {
+    throw Error(_("Package directory not found: ") + dir);
+  }
+  reset();
+}
 
 PackagedP PackageManager::openAny(const String& name_, bool just_header) {
   String name = trim(name_);
@@ -57,41 +73,168 @@ PackagedP PackageManager::openAny(const String& name_, bool just_header) {
   }
 
   // Is this package already loaded?
-  PackagedP& p = loaded_packages[filename];
-  if (!p) {
-    // load with the right type, based on extension
-    wxFileName fn(filename);
-    if      (fn.GetExt() == _("mse-game"))            p = make_intrusive<Game>();
-    else if (fn.GetExt() == _("mse-style"))           p = make_intrusive<StyleSheet>();
-    else if (fn.GetExt() == _("mse-locale"))          p = make_intrusive<Locale>();
-    else if (fn.GetExt() == _("mse-include"))         p = make_intrusive<IncludePackage>();
-    else if (fn.GetExt() == _("mse-symbol-font"))     p = make_intrusive<SymbolFont>();
-    else if (fn.GetExt() == _("mse-export-template")) p = make_intrusive<ExportTemplate>();
-    else {
-      throw PackageError(_("Unrecognized package type: '") + fn.GetExt() + _("'\nwhile trying to open: ") + name);
+  auto it = loaded_packages.find(filename);
+  if (it == loaded_packages.end()) {
+    PackagedP p = newPackaged(filename, name);
+    if (just_header) {
+      p->open(filename, true);
+    } else {
+      p->openForLoading(filename);
     }
-    p->open(filename, just_header);
-  } else if (!just_header) {
+    // only remember packages that could be opened
+    loaded_packages[filename] = p;
+    if (!just_header) {
+      preloadDependencies(p);
+      p->loadFully();
+    }
+    return p;
+  } else if (!just_header && !it->second->isFullyLoaded()) {
+    PackagedP p = it->second;
+    preloadDependencies(p);
     p->loadFully();
+    return p;
+  } else {
+    return it->second;
+  }
+}
+
+void PackageManager::preloadDependencies(const PackagedP& package) {
+  // find all packages that this package (indirectly) depends on, from their headers
+  vector<PackagedP> needed(1, package);
+  set<Packaged*> seen;
+  seen.insert(package.get());
+  for (size_t i = 0 ; i < needed.size() ; ++i) {
+    FOR_EACH_CONST(dep, needed[i]->dependencies) {
+      PackagedP p;
+      try {
+        p = openAny(dep->package, true);
+      } catch (const Error&) {
+        continue; // reported when the dependency is actually used
+      }
+      if (seen.insert(p.get()).second) needed.push_back(p);
+    }
+  }
+  // read the data files that are not yet loaded in parallel, they are parsed later, in order, on this thread
+  vector<PackagedP> to_preload;
+  FOR_EACH(p, needed) {
+    if (!p->isFullyLoaded()) to_preload.push_back(p);
+  }
+  if (to_preload.size() <= 1) return; // nothing to gain
+  PROFILER(_("preload packages"));
+  for_each_package_in_parallel(to_preload.size(), [&](size_t i) {
+    to_preload[i]->preload();
+  });
+}
+
+PackagedP PackageManager::newPackaged(const String& filename, const String& name) {
+  // load with the right type, based on extension
+  wxFileName fn(filename);
+  if      (fn.GetExt() == _("mse-game"))            return make_intrusive<Game>();
+  else if (fn.GetExt() == _("mse-style"))           return make_intrusive<StyleSheet>();
+  else if (fn.GetExt() == _("mse-locale"))          return make_intrusive<Locale>();
+  else if (fn.GetExt() == _("mse-include"))         return make_intrusive<IncludePackage>();
+  else if (fn.GetExt() == _("mse-symbol-font"))     return make_intrusive<SymbolFont>();
+  else if (fn.GetExt() == _("mse-export-template")) return make_intrusive<ExportTemplate>();
+  else {
+    throw PackageError(_("Unrecognized package type: '") + fn.GetExt() + _("'\nwhile trying to open: ") + name);
   }
-  return p;
 }
 
 void PackageManager::findMatching(const String& pattern, vector<PackagedP>& out) {
-  // first find local packages
-  String file = local.findFirstMatching(pattern);
-  while (!file.empty()) {
-    out.push_back(openAny(file, true));
-    file = wxFindNextFile();
-  }
-  // then global packages not already in the list
-  file = global.findFirstMatching(pattern);
-  while (!file.empty()) {
-    PackagedP p = openAny(file, true);
-    if (find(out.begin(), out.end(), p) == out.end()) {
-      out.push_back(p);
+  // first find local packages, then global packages not already in the list
+  vector<String> filenames;
+  for (String file = local.findFirstMatching(pattern) ; !file.empty() ; file = wxFindNextFile()) {
+    filenames.push_back(normalize_filename(file));
+  }
+  for (String file = global.findFirstMatching(pattern) ; !file.empty() ; file = wxFindNextFile()) {
+    String filename = normalize_filename(file);
+    if (find(filenames.begin(), filenames.end(), filename) == filenames.end()) {
+      filenames.push_back(filename);
+    }
+  }
+  // open them all at once, most headers come from the snapshot, the rest is read in parallel
+  openHeaders(filenames);
+  FOR_EACH(filename, filenames) {
+    out.push_back(loaded_packages[filename]);
+  }
+}
+
+/// Does work on packages in a worker thread
+/** Each package is claimed by exactly one thread through the shared counter.
+ */
+class PackageWorkerThread : public wxThread {
+public:
+  PackageWorkerThread(size_t count, const function<void(size_t)>& work, std::atomic<size_t>& next_package)
+    : wxThread(wxTHREAD_JOINABLE), count(count), work(work), next_package(next_package)
+  {}
+  
+  ExitCode Entry() override {
+    run(count, work, next_package);
+    return 0;
+  }
+  
+  static void run(size_t count, const function<void(size_t)>& work, std::atomic<size_t>& next_package) {
+    for (size_t i = next_package++ ; i < count ; i = next_package++) {
+      work(i);
+    }
+  }
+  
+private:
+  size_t count;
+  const function<void(size_t)>& work;
+  std::atomic<size_t>& next_package;
+};
+
+/// Maximum number of threads for reading packages, this is mostly waiting for the disk
+const size_t MAX_PACKAGE_THREADS = 8;
+
+/// Call work(i) for all i < count, using multiple threads
+/** The work must not throw */
+static void for_each_package_in_parallel(size_t count, const function<void(size_t)>& work) {
+  std::atomic<size_t> next_package(0);
+  vector<PackageWorkerThread*> threads;
+  size_t thread_count = min(count, min(MAX_PACKAGE_THREADS, (size_t)max(1, wxThread::GetCPUCount())));
+  for (size_t i = 1 ; i < thread_count ; ++i) {
+    PackageWorkerThread* thread = new PackageWorkerThread(count, work, next_package);
+    if (thread->Run() == wxTHREAD_NO_ERROR) {
+      threads.push_back(thread);
+    } else {
+      delete thread;
+      break;
+    }
+  }
+  // this thread helps as well
+  PackageWorkerThread::run(count, work, next_package);
+  FOR_EACH(thread, threads) {
+    thread->Wait();
+    delete thread;
+  }
+}
+
+void PackageManager::openHeaders(const vector<String>& filenames) {
+  // which packages are not loaded yet?
+  vector<PackagedP> to_open;
+  vector<String> to_open_filenames;
+  FOR_EACH_CONST(filename, filenames) {
+    if (loaded_packages.find(filename) != loaded_packages.end()) continue;
+    to_open.push_back(newPackaged(filename, filename));
+    to_open_filenames.push_back(filename);
+  }
+  if (to_open.empty()) return;
+  // open them, errors are thrown again on this thread
+  PROFILER(_("open package headers"));
+  vector<std::exception_ptr> errors(to_open.size());
+  for_each_package_in_parallel(to_open.size(), [&](size_t i) {
+    try {
+      to_open[i]->open(to_open_filenames[i], true);
+    } catch (...) {
+      errors[i] = std::current_exception();
     }
-    file = wxFindNextFile();
+  });
+  // remember the opened packages, in order, so the first error is the one openAny would have given
+  for (size_t i = 0 ; i < to_open.size() ; ++i) {
+    if (errors[i]) std::rethrow_exception(errors[i]);
+    loaded_packages[to_open_filenames[i]] = to_open[i];
   }
 }
 
@@ -10,6 +10,7 @@
 
 #include <util/prec.hpp>
 #include <util/io/package.hpp>
+#include <util/io/package_snapshot.hpp>
 #include <wx/filename.h>
 
 DECLARE_POINTER_TYPE(Packaged);
@@ -116,6 +117,9 @@ public:
   void destroy();
   /// Empty the list of packages, they will all be reloaded
   void reset();
+  /// Use a different directory for local packages, for example for tests and benchmarks
+  /** Packages in this directory take precedence over the global data directory */
+  void setLocalDirectory(const String& dir);
   
   // --------------------------------------------------- : Packages in memory
   
@@ -174,11 +178,25 @@ public:
   /// Get the directory for dictionary files
   String getDictionaryDir(bool local) const;
   
+  /// Headers of installed packages, remembered between runs
+  PackageSnapshot header_snapshot;
+  
   // --------------------------------------------------- : Packages on a server
   
 private:
   map<String, PackagedP> loaded_packages;
   PackageDirectory local, global;
+  
+  /// Create a package object of the right type for a filename, based on the extension
+  static PackagedP newPackaged(const String& filename, const String& name);
+  /// Open the headers of all given packages that are not yet loaded, in parallel
+  /** The filenames must be normalized.
+   *  If opening fails, the error of the first failing package is thrown.
+   */
+  void openHeaders(const vector<String>& filenames);
+  /// Read the data files of a package and everything it depends on, in parallel
+  /** The packages are parsed later, when they are opened or used, by the calling thread. */
+  void preloadDependencies(const PackagedP& package);
 };
 
 /// The global PackageManager instance
@@ -0,0 +1,164 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/io/package_snapshot.hpp>
+#include <util/io/package.hpp>
+#include <util/error.hpp>
+#include <wx/wfstream.h>
+#include <wx/mstream.h>
+#include <wx/datstrm.h>
+#include <wx/filename.h>
+
+// ----------------------------------------------------------------------------- : File format
+
+// The file consists of:
+//   magic, format version, app version, number of entries
+//   for each entry: package filename, data file modification time and size, header fields
+// All strings are UTF-8, all numbers little endian.
+
+static const wxUint32 SNAPSHOT_MAGIC   = 0x4853534D; // "MSSH"
+static const wxUint32 SNAPSHOT_VERSION = 2;
+
+// ----------------------------------------------------------------------------- : Loading
+
+void PackageSnapshot::load(const String& filename) {
+  this->filename = filename;
+  entries.clear();
+  changed = false;
+  if (!wxFileExists(filename)) return;
+  // read the whole file at once
+  wxMemoryBuffer buffer;
+  {
+    wxFileInputStream file(filename);
+    if (!file.IsOk()) return;
+    size_t size = (size_t)file.GetLength();
+    if (file.Read(buffer.GetWriteBuf(size), size).LastRead() != size) return;
+    buffer.UngetWriteBuf(size);
+  }
+  wxMemoryInputStream stream(buffer.GetData(), buffer.GetDataLen());
+  wxDataInputStream data(stream, wxConvUTF8);
+  data.BigEndianOrdered(false);
+  if (data.Read32() != SNAPSHOT_MAGIC || data.Read32() != SNAPSHOT_VERSION || data.Read32() != app_version.toNumber()) {
+    changed = true; // outdated, rewrite it
+    return;
+  }
+  wxUint32 count = data.Read32();
+  for (wxUint32 i = 0 ; i < count && stream.IsOk() ; ++i) {
+    String package = data.ReadString();
+    Entry e;
+    e.data_modified      = (time_t)data.Read64();
+    e.data_size          = data.Read64();
+    e.version            = Version(data.Read32());
+    e.compatible_version = Version(data.Read32());
+    e.installer_group    = data.ReadString();
+    e.short_name         = data.ReadString();
+    e.full_name          = data.ReadString();
+    e.icon_filename      = data.ReadString();
+    e.position_hint      = (int)data.Read32();
+    wxUint32 dep_count = data.Read32();
+    for (wxUint32 j = 0 ; j < dep_count && stream.IsOk() ; ++j) {
+      Dependency dep;
+      dep.package = data.ReadString();
+      dep.version = Version(data.Read32());
+      wxUint32 suggest_count = data.Read32();
+      for (wxUint32 k = 0 ; k < suggest_count && stream.IsOk() ; ++k) {
+        dep.suggests.push_back(data.ReadString());
+      }
+      e.dependencies.push_back(std::move(dep));
+    }
+    if (stream.IsOk()) entries[package] = std::move(e);
+  }
+  if (entries.size() != count) {
+    // damaged file, don't trust any of it
+    entries.clear();
+    changed = true;
+  }
+}
+
+// ----------------------------------------------------------------------------- : Saving
+
+void PackageSnapshot::save() {
+  wxMutexLocker lock(mutex);
+  if (!changed || filename.empty()) return;
+  wxFileOutputStream file(filename);
+  if (!file.IsOk()) return; // failure is not an error, it is just a cache
+  wxDataOutputStream data(file, wxConvUTF8);
+  data.BigEndianOrdered(false);
+  data.Write32(SNAPSHOT_MAGIC);
+  data.Write32(SNAPSHOT_VERSION);
+  data.Write32(app_version.toNumber());
+  data.Write32((wxUint32)entries.size());
+  FOR_EACH_CONST(it, entries) {
+    const Entry& e = it.second;
+    data.WriteString(it.first);
+    data.Write64((wxUint64)e.data_modified);
+    data.Write64(e.data_size);
+    data.Write32(e.version.toNumber());
+    data.Write32(e.compatible_version.toNumber());
+    data.WriteString(e.installer_group);
+    data.WriteString(e.short_name);
+    data.WriteString(e.full_name);
+    data.WriteString(e.icon_filename);
+    data.Write32((wxUint32)e.position_hint);
+    data.Write32((wxUint32)e.dependencies.size());
+    FOR_EACH_CONST(dep, e.dependencies) {
+      data.WriteString(dep.package);
+      data.Write32(dep.version.toNumber());
+      data.Write32((wxUint32)dep.suggests.size());
+      FOR_EACH_CONST(s, dep.suggests) data.WriteString(s);
+    }
+  }
+  changed = false;
+}
+
+// ----------------------------------------------------------------------------- : Entries
+
+bool PackageSnapshot::restoreHeader(Packaged& package, time_t data_modified, wxUint64 data_size) const {
+  wxMutexLocker lock(mutex);
+  auto it = entries.find(package.absoluteFilename());
+  if (it == entries.end() || data_modified == 0) return false;
+  if (it->second.data_modified != data_modified || it->second.data_size != data_size) return false;
+  const Entry& e = it->second;
+  package.version            = e.version;
+  package.compatible_version = e.compatible_version;
+  package.installer_group    = e.installer_group;
+  package.short_name         = e.short_name;
+  package.full_name          = e.full_name;
+  package.icon_filename      = e.icon_filename;
+  package.position_hint      = e.position_hint;
+  package.dependencies.clear();
+  FOR_EACH_CONST(d, e.dependencies) {
+    PackageDependencyP dep = make_intrusive<PackageDependency>();
+    dep->package  = d.package;
+    dep->version  = d.version;
+    dep->suggests = d.suggests;
+    package.dependencies.push_back(dep);
+  }
+  return true;
+}
+
+void PackageSnapshot::storeHeader(const Packaged& package, time_t data_modified, wxUint64 data_size) {
+  if (data_modified == 0) return;
+  wxMutexLocker lock(mutex);
+  Entry& e = entries[package.absoluteFilename()];
+  e.data_modified      = data_modified;
+  e.data_size          = data_size;
+  e.version            = package.version;
+  e.compatible_version = package.compatible_version;
+  e.installer_group    = package.installer_group;
+  e.short_name         = package.short_name;
+  e.full_name          = package.full_name;
+  e.icon_filename      = package.icon_filename;
+  e.position_hint      = package.position_hint;
+  e.dependencies.clear();
+  FOR_EACH_CONST(d, package.dependencies) {
+    e.dependencies.push_back(Dependency{d->package, d->suggests, d->version});
+  }
+  changed = true;
+}
@@ -0,0 +1,62 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/version.hpp>
+#include <unordered_map>
+#include <wx/thread.h>
+
+class Packaged;
+
+// ----------------------------------------------------------------------------- : PackageSnapshot
+
+/// A binary cache of the headers of installed packages
+/** Listing the installed games and stylesheets only needs the package headers (name, icon, version, etc.),
+ *  but the header is at the start of the data file, so getting it means reading that file.
+ *  The snapshot remembers the headers between runs, so unchanged packages don't have to be read at all.
+ *
+ *  An entry is only used if the data file of the package has the same modification time and size as when the entry was made.
+ *  The whole snapshot is discarded if it was written by a different version of MSE.
+ *
+ *  Headers can be restored and stored from multiple threads at once.
+ *  Fully loading a package always reads its data file.
+ */
+class PackageSnapshot {
+public:
+  /// Load the snapshot from a file, a missing, damaged or outdated file is ignored
+  void load(const String& filename);
+  /// Write the snapshot back to the file it was loaded from, if anything changed
+  void save();
+  
+  /// Fill in the header of a package from the snapshot
+  /** Returns false if there is no up to date entry for the package */
+  bool restoreHeader(Packaged& package, time_t data_modified, wxUint64 data_size) const;
+  /// Remember the header of a package that was just read
+  void storeHeader(const Packaged& package, time_t data_modified, wxUint64 data_size);
+  
+private:
+  struct Dependency {
+    String package;
+    vector<String> suggests;
+    Version version;
+  };
+  struct Entry {
+    time_t  data_modified;
+    wxUint64 data_size;
+    Version version, compatible_version;
+    String  installer_group, short_name, full_name, icon_filename;
+    int     position_hint;
+    vector<Dependency> dependencies;
+  };
+  String filename;
+  unordered_map<String, Entry> entries; ///< Entries by absolute package filename
+  bool changed = false;
+  mutable wxMutex mutex; ///< Protects entries and changed
+};
@@ -17,14 +17,33 @@ using boost::tribool;
 
 // ----------------------------------------------------------------------------- : Reader
 
+const String Reader::empty_key;
+
+/// Read the remainder of a stream into a buffer
+static void read_all(wxInputStream& input, std::string& out) {
+  wxFileOffset size = input.GetLength(), pos = input.TellI();
+  if (size != wxInvalidOffset && pos != wxInvalidOffset && size > pos) {
+    out.reserve((size_t)(size - pos));
+  }
+  char chunk[16384];
+  while (input.Read(chunk, sizeof(chunk)).LastRead() > 0) {
+    out.append(chunk, input.LastRead());
+  }
+}
+
 Reader::Reader(wxInputStream& input, Packaged* package, const String& filename, bool ignore_invalid)
-  : indent(0), expected_indent(0), state(OUTSIDE)
+  : buffer_pos(0), eof(false)
+  , key(&empty_key)
+  , indent(0), expected_indent(0), state(OUTSIDE)
   , ignore_invalid(ignore_invalid)
   , filename(filename), package(package), line_number(0), previous_line_number(0)
-  , input(input)
 {
   assert(input.IsOk());
-  eat_utf8_bom(input);
+  read_all(input, buffer);
+  if (buffer.size() >= 3 && buffer.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+    buffer_pos = 3; // utf-8 byte order mark
+  }
+  line_begin = line_end = value_begin = value_end = buffer.data();
   moveNext();
   handleAppVersion();
 }
@@ -69,7 +88,7 @@ bool Reader::enterAnyBlock() {
 bool Reader::enterBlock(const Char* name) {
   if (state == ENTERED) moveNext(); // on the key of the parent block, first move inside it
   if (indent != expected_indent) return false; // not enough indentation
-  if (key == name) {
+  if (key->GetChar(0) == name[0] && *key == name) { // most keys differ in the first character
     state = ENTERED;
     expected_indent += 1; // the indent inside the block must be at least this much
     return true;
@@ -95,14 +114,14 @@ void Reader::exitBlock() {
 void Reader::moveNext() {
   previous_line_number = line_number;
   state = HANDLED;
-  key.clear();
+  key = &empty_key;
   indent = -1; // if no line is read it never has the expected indentation
   // repeat until we have a good line
-  while (key.empty() && !input.Eof()) {
+  while (key->empty() && !eof) {
     readLine();
   }
   // did we reach the end of the file?
-  if (key.empty() && input.Eof()) {
+  if (key->empty() && eof) {
     line_number += 1;
     indent = -1;
   }
@@ -185,47 +204,105 @@ String read_utf8_line(wxInputStream& input, bool until_eof) {
   return wxString::FromUTF8(buffer.get(), buffer.size());
 }
 
+/// Whitespace as removed by trim(), restricted to ASCII
+static inline bool is_space_byte(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
 void Reader::readLine(bool in_string) {
   line_number += 1;
   // We have to do our own line reading, because wxTextInputStream is insane
-  try {
-    line = read_utf8_line(input);
-  } catch (const ParseError& e) {
-    throw ParseError(e.what() + String(_(" on line ")) << line_number);
+  // find the end of the line
+  const char* begin = buffer.data() + buffer_pos;
+  const char* buffer_end = buffer.data() + buffer.size();
+  const char* end = begin;
+  bool ascii = true;
+  while (end != buffer_end && *end != '\n' && *end != '\r') {
+    ascii &= (unsigned char)*end < 0x80;
+    ++end;
+  }
+  if (end == buffer_end) {
+    eof = true;
+    buffer_pos = buffer.size();
+  } else if (*end == '\r' && end + 1 != buffer_end && end[1] == '\n') {
+    buffer_pos = end + 2 - buffer.data();
+  } else {
+    buffer_pos = end + 1 - buffer.data();
+    if (buffer_pos == buffer.size() && *end == '\r') eof = true; // the reader looks for a '\n' after '\r'
+  }
+  if (!ascii && wxConvUTF8.ToWChar(nullptr, 0, begin, end - begin) == size_t(-1)) {
+    throw ParseError(String(_("Invalid UTF-8 sequence on line ")) << line_number);
   }
+  line_begin = begin;
+  line_end   = end;
+  value_begin = value_end = end;
   // read indentation
   indent = 0;
-  while ((UInt)indent < line.size() && line.GetChar(indent) == _('\t')) {
+  while (begin + indent != end && begin[indent] == '\t') {
     indent += 1;
   }
   // read key / value
-  if (line.find_first_not_of(_(" \t")) == String::npos || line.GetChar(indent) == _('#')) {
+  const char* first = begin + indent;
+  while (first != end && (*first == ' ' || *first == '\t')) ++first;
+  if (first == end || begin[indent] == '#') {
     // empty line or comment
-    key.clear();
+    key = &empty_key;
     return;
   }
-  size_t pos = line.find_first_of(_(':'), indent);
-  key = line.substr(indent, pos - indent);
-  if (!ignore_invalid && !in_string && starts_with(key, _(" "))) {
-    warning(_("key: '") + key + _("' starts with a space; only use TABs for indentation!"), 0, false);
+  const char* key_begin = begin + indent;
+  const char* colon = (const char*)memchr(key_begin, ':', end - key_begin);
+  const char* key_end = colon ? colon : end;
+  if (!ignore_invalid && !in_string && *key_begin == ' ') {
+    warning(_("key: '") + String::FromUTF8(key_begin, key_end - key_begin) + _("' starts with a space; only use TABs for indentation!"), 0, false);
     // try to fix up: 8 spaces is a tab
-    while (starts_with(key, _("        "))) {
-      key = key.substr(8);
+    while (key_end - key_begin >= 8 && memcmp(key_begin, "        ", 8) == 0) {
+      key_begin += 8;
       indent += 1;
     }
   }
-  key = canonical_name_form(trim(key));
-  if (pos == String::npos) {
+  while (key_begin != key_end && is_space_byte(*key_begin))  ++key_begin;
+  while (key_begin != key_end && is_space_byte(key_end[-1])) --key_end;
+  if (!colon) {
     if (!ignore_invalid && !in_string) {
       warning(_("Missing ':' "), 0, false);
     }
-    value.clear();
   } else {
-    value = trim_left(substr(line, pos+1));
+    value_begin = colon + 1;
+    while (value_begin != end && is_space_byte(*value_begin)) ++value_begin;
   }
-  if (key.empty() && pos!=String::npos) {
-    key = _(" "); // we don't want an empty key if there was a colon
+  if (key_begin == key_end && colon) {
+    key_begin = " "; // we don't want an empty key if there was a colon
+    key_end   = key_begin + 1;
+  }
+  key = &internKey(key_begin, key_end);
+}
+
+bool Reader::lineIsBlank() const {
+  for (const char* it = line_begin ; it != line_end ; ++it) {
+    if (!is_space_byte(*it)) return (unsigned char)*it >= 0x80 && trim(String::FromUTF8(line_begin, line_end - line_begin)).empty();
+  }
+  return true;
+}
+
+const String& Reader::internKey(const char* begin, const char* end) {
+  std::string_view text(begin, end - begin);
+  auto it = key_table.find(text);
+  if (it != key_table.end()) return it->second;
+  // a key we have not seen before
+  String name = String::FromUTF8(begin, end - begin);
+  if (!name.empty() && (isSpace(name.GetChar(0)) || isSpace(name.GetChar(name.size() - 1)))) {
+    name = trim(name);
+  }
+  canonical_name_form_in_place(name);
+  return key_table.emplace(text, std::move(name)).first->second;
+}
+
+String Reader::currentValue() const {
+  String value = String::FromUTF8(value_begin, value_end - value_begin);
+  if (!value.empty() && isSpace(value.GetChar(0))) {
+    return trim_left(value);
   }
+  return value;
 }
 
 void Reader::unknownKey() {
@@ -237,7 +314,7 @@ void Reader::unknownKey() {
     return;
   }
   if (indent >= expected_indent) {
-    warning(_("Unexpected key: '") + key + _("'"), 0, false);
+    warning(_("Unexpected key: '") + *key + _("'"), 0, false);
     do {
       moveNext();
     } while (indent > expected_indent);
@@ -257,30 +334,31 @@ const String& Reader::getValue() {
   if (state == UNHANDLED) {
     state = HANDLED;
     return previous_value;
-  } else if (value.empty()) {
+  } else if (value_begin == value_end) {
     // a multiline string
     previous_value.clear();
     int pending_newlines = 0;
     // read all lines that are indented enough
     readLine(true);
     previous_line_number = line_number;
-    while (indent >= expected_indent && !input.Eof()) {
+    while (indent >= expected_indent && !eof) {
       previous_value.resize(previous_value.size() + pending_newlines, _('\n'));
       pending_newlines = 0;
-      previous_value += line.substr(expected_indent); // strip expected indent
+      // strip expected indent, the indentation consists of single byte tabs
+      previous_value += String::FromUTF8(line_begin + expected_indent, line_end - line_begin - expected_indent);
       do {
         readLine(true);
         pending_newlines++;
         // skip empty lines that are not indented enough
-      } while(trim(line).empty() && indent < expected_indent && !input.Eof());
+      } while(lineIsBlank() && indent < expected_indent && !eof);
     }
     // moveNext(), but without the initial readLine()
     state = HANDLED;
-    while (key.empty() && !input.Eof()) {
+    while (key->empty() && !eof) {
       readLine();
     }
     // did we reach the end of the file?
-    if (key.empty() && input.Eof()) {
+    if (key->empty() && eof) {
       line_number += 1;
       indent = -1;
     }
@@ -291,7 +369,7 @@ const String& Reader::getValue() {
     }
     return previous_value;
   } else {
-    previous_value = value;
+    previous_value = currentValue();
     moveNext();
     return previous_value;
   }
@@ -10,9 +10,8 @@
 
 #include <util/prec.hpp>
 #include <util/version.hpp>
-#ifdef __APPLE__
-    #include <unordered_map>
-#endif
+#include <unordered_map>
+#include <string_view>
 
 template <typename T> class Defaultable;
 template <typename T> class Scriptable;
@@ -30,6 +29,10 @@ pair<unique_ptr<wxInputStream>, Packaged*> openFileFromPackage(Packaged* package
  *
  *  The handle functions ensure that afterwards the reader is at the line after the
  *  object that was just read.
+ *
+ *  The whole input is read into memory up front and tokenized in place, as UTF-8.
+ *  Keys are interned, so a key that appears many times is decoded only once,
+ *  and values are only decoded when they are actually handled.
  */
 class Reader {
 public:
@@ -46,7 +49,7 @@ public:
   static constexpr bool isWriting = false;
   static constexpr bool isScripting = false;
   /// Is the thing currently being read 'complex', i.e. does it have children
-  inline bool isCompound() const { return indent != expected_indent - 1 || value.empty(); }
+  inline bool isCompound() const { return indent != expected_indent - 1 || value_begin == value_end; }
   /// Ignore old keys
   void handleIgnore(int, const Char*);
   /// Get the version of the format we are reading
@@ -121,10 +124,23 @@ private:
   // --------------------------------------------------- : Data
   /// App version this file was made with
   Version file_app_version;
-  /// The line we read
-  String line;
-  /// The key and value of the last line we read
-  String key, value;
+  /// The complete input, UTF-8 encoded
+  std::string buffer;
+  /// Position in the buffer of the next line to read
+  size_t buffer_pos;
+  /// Have we read the last line of the input?
+  bool eof;
+  /// The line we read, a range in the buffer
+  const char* line_begin;
+  const char* line_end;
+  /// The value of the last line we read, a range in the buffer
+  const char* value_begin;
+  const char* value_end;
+  /// The key of the last line we read, an entry in key_table, or empty_key if the line has no key
+  const String* key;
+  /// All distinct keys in the input, indexed by their (trimmed) UTF-8 text in the buffer
+  unordered_map<std::string_view, String> key_table;
+  static const String empty_key;
   /// Value of the *previous* line, only valid in state==HANDLED
   String previous_value;
   /// Indentation of the last line we read
@@ -149,8 +165,6 @@ private:
   int line_number;
   /// Line number of the previous_line
   int previous_line_number;
-  /// Input stream we are reading from
-  wxBufferedInputStream input;
   /// Accumulated warning messages
   String warnings;
   
@@ -167,6 +181,12 @@ private:
   void moveNext();
   /// Reads the next line from the input, and stores it in line/key/value/indent
   void readLine(bool in_string = false);
+  /// Is the current line empty or only whitespace?
+  bool lineIsBlank() const;
+  /// Find or add a key in the key_table
+  const String& internKey(const char* begin, const char* end);
+  /// The value on the current line, without handling it
+  String currentValue() const;
   
   /// Return the value on the current line
   const String& getValue();
@@ -175,9 +195,10 @@ private:
   /** Maybe the key is "include file" */
   template <typename T>
   void unknownKey(T& v) {
-    if (key == _("include_file")) {
-      auto [stream, include_package] = openFileFromPackage(package, value);
-      Reader sub_reader(*stream, include_package, value, ignore_invalid);
+    if (*key == _("include_file")) {
+      String include_name = currentValue();
+      auto [stream, include_package] = openFileFromPackage(package, include_name);
+      Reader sub_reader(*stream, include_package, include_name, ignore_invalid);
       if (sub_reader.file_app_version == 0) {
         // in an included file, use the app version of the parent if there is none
         sub_reader.file_app_version = file_app_version;
@@ -238,7 +259,7 @@ void Reader::handle(intrusive_ptr<T>& pointer) {
 template <typename V>
 void Reader::handle(map<String, V>& m) {
   while (enterAnyBlock()) {
-    handle_greedy(m[key]);
+    handle_greedy(m[*key]);
     exitBlock();
   }
 }
@@ -246,7 +267,7 @@ void Reader::handle(map<String, V>& m) {
 template <typename V>
 void Reader::handle(unordered_map<String, V>& m) {
   while (enterAnyBlock()) {
-    handle_greedy(m[key]);
+    handle_greedy(m[*key]);
     exitBlock();
   }
 }
@@ -79,6 +79,10 @@
     inline bool matches(Results& results, const String::const_iterator& begin, const String::const_iterator& end) const {
       return regex_search(begin, end, results, regex);
     }
+    /// Match only at begin, equivalent to matches(..) && results.position() == 0
+    inline bool matchesPrefix(Results& results, const String::const_iterator& begin, const String::const_iterator& end) const {
+      return regex_search(begin, end, results, regex, boost::match_continuous);
+    }
     String replace_all(const String& input, const String& format) const;
     
     inline bool empty() const {
@@ -158,6 +162,9 @@
       results.begin = begin;
       return regex.Matches(begin, 0, end - begin);
     }
+    inline bool matchesPrefix(Results& results, const Char* begin, const Char* end) const {
+      return matches(results, begin, end) && results.position() == 0;
+    }
     inline void replace_all(String* input, const String& format) {
       regex.Replace(input, format);
     }
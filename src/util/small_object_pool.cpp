@@ -0,0 +1,179 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/small_object_pool.hpp>
+#include <mutex>
+#include <atomic>
+
+// ----------------------------------------------------------------------------- : Constants
+
+const size_t SIZE_CLASS_GRANULARITY = 16;
+const size_t MAX_SMALL_OBJECT_SIZE  = 256;
+const size_t SIZE_CLASS_COUNT       = MAX_SMALL_OBJECT_SIZE / SIZE_CLASS_GRANULARITY;
+/// Size of the chunks of memory requested from the system
+const size_t POOL_CHUNK_SIZE        = 64 * 1024;
+/// Number of blocks moved between a thread cache and the depot at once
+const size_t POOL_BATCH_SIZE        = 64;
+/// When a thread cache has more free blocks than this, some are given back to the depot
+const size_t MAX_CACHED_BLOCKS      = 4 * POOL_BATCH_SIZE;
+
+inline size_t size_class(size_t size) {
+  return (size + SIZE_CLASS_GRANULARITY - 1) / SIZE_CLASS_GRANULARITY - 1;
+}
+inline size_t block_size(size_t size_class) {
+  return (size_class + 1) * SIZE_CLASS_GRANULARITY;
+}
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// ----------------------------------------------------------------------------- : Depot
+
+/// Free blocks shared by all threads
+struct PoolDepot {
+  std::mutex mutex;
+  FreeBlock* free[SIZE_CLASS_COUNT] = {};
+  char*      chunk_pos = nullptr; ///< Unused part of the current chunk
+  char*      chunk_end = nullptr;
+  std::atomic<size_t> system_allocations{0};
+  std::atomic<size_t> system_bytes{0};
+
+  /// Take up to n blocks, returns them as a list, and the number of blocks in count
+  FreeBlock* take(size_t c, size_t n, size_t& count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    FreeBlock* list = nullptr;
+    count = 0;
+    // first reuse freed blocks
+    while (count < n && free[c]) {
+      FreeBlock* b = free[c];
+      free[c] = b->next;
+      b->next = list;
+      list = b;
+      ++count;
+    }
+    // then cut new ones from the chunk
+    size_t size = block_size(c);
+    while (count < n) {
+      if ((size_t)(chunk_end - chunk_pos) < size) {
+        // the rest of the old chunk is wasted, it is smaller than a block
+        chunk_pos = static_cast<char*>(::operator new(POOL_CHUNK_SIZE));
+        chunk_end = chunk_pos + POOL_CHUNK_SIZE;
+        system_allocations.fetch_add(1, memory_order_relaxed);
+        system_bytes.fetch_add(POOL_CHUNK_SIZE, memory_order_relaxed);
+      }
+      FreeBlock* b = reinterpret_cast<FreeBlock*>(chunk_pos);
+      chunk_pos += size;
+      b->next = list;
+      list = b;
+      ++count;
+    }
+    return list;
+  }
+
+  /// Give back a list of blocks
+  void give(size_t c, FreeBlock* first, FreeBlock* last) {
+    std::lock_guard<std::mutex> lock(mutex);
+    last->next = free[c];
+    free[c] = first;
+  }
+};
+
+/// The depot is never destroyed, because values can be freed by destructors of globals
+static PoolDepot& depot() {
+  static PoolDepot* d = new PoolDepot;
+  return *d;
+}
+
+// ----------------------------------------------------------------------------- : Thread cache
+
+/// Free blocks of a single thread
+struct PoolThreadCache {
+  FreeBlock* free[SIZE_CLASS_COUNT] = {};
+  size_t     count[SIZE_CLASS_COUNT] = {};
+  ~PoolThreadCache();
+
+  /// Give n blocks of size class c back to the depot
+  void giveBack(size_t c, size_t n) {
+    if (n == 0 || !free[c]) return;
+    FreeBlock* first = free[c];
+    FreeBlock* last  = first;
+    size_t given = 1;
+    while (given < n && last->next) {
+      last = last->next;
+      ++given;
+    }
+    free[c] = last->next;
+    count[c] -= given;
+    depot().give(c, first, last);
+  }
+};
+
+static thread_local PoolThreadCache thread_cache;
+/// Has thread_cache already been destroyed? Then blocks go directly to the depot.
+static thread_local bool thread_cache_destroyed = false;
+static thread_local size_t thread_allocations = 0;
+
+PoolThreadCache::~PoolThreadCache() {
+  for (size_t c = 0 ; c < SIZE_CLASS_COUNT ; ++c) {
+    giveBack(c, count[c]);
+  }
+  thread_cache_destroyed = true;
+}
+
+// ----------------------------------------------------------------------------- : Allocation
+
+void* small_object_allocate(size_t size) {
+  if (size > MAX_SMALL_OBJECT_SIZE) return ::operator new(size);
+  if (size == 0) size = 1;
+  ++thread_allocations;
+  size_t c = size_class(size);
+  if (thread_cache_destroyed) {
+    size_t count;
+    return depot().take(c, 1, count);
+  }
+  PoolThreadCache& cache = thread_cache;
+  if (!cache.free[c]) {
+    cache.free[c] = depot().take(c, POOL_BATCH_SIZE, cache.count[c]);
+  }
+  FreeBlock* b = cache.free[c];
+  cache.free[c] = b->next;
+  --cache.count[c];
+  return b;
+}
+
+void small_object_free(void* ptr, size_t size) {
+  if (!ptr) return;
+  if (size > MAX_SMALL_OBJECT_SIZE) {
+    ::operator delete(ptr);
+    return;
+  }
+  if (size == 0) size = 1;
+  size_t c = size_class(size);
+  FreeBlock* b = static_cast<FreeBlock*>(ptr);
+  if (thread_cache_destroyed) {
+    depot().give(c, b, b);
+    return;
+  }
+  PoolThreadCache& cache = thread_cache;
+  b->next = cache.free[c];
+  cache.free[c] = b;
+  if (++cache.count[c] > MAX_CACHED_BLOCKS) {
+    cache.giveBack(c, MAX_CACHED_BLOCKS - POOL_BATCH_SIZE);
+  }
+}
+
+SmallObjectPoolStats small_object_pool_stats() {
+  PoolDepot& d = depot();
+  return SmallObjectPoolStats{
+    thread_allocations,
+    d.system_allocations.load(memory_order_relaxed),
+    d.system_bytes.load(memory_order_relaxed)
+  };
+}
@@ -0,0 +1,34 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+// ----------------------------------------------------------------------------- : Small object pool
+
+/// Allocate memory for a small object that is created and destroyed often
+/** Sizes are rounded up to size classes of 16 bytes, objects larger than 256 bytes use the normal operator new.
+ *  Each thread keeps a cache of free blocks for every size class, so most allocations don't take a lock.
+ *  Memory is taken from the system in large chunks, and is never returned to it,
+ *  the cache of a thread is given to the other threads when it ends.
+ *
+ *  Memory can be freed by a different thread than the one that allocated it.
+ */
+void* small_object_allocate(size_t size);
+
+/// Free memory from small_object_allocate, size must be the same as when allocating
+void small_object_free(void* ptr, size_t size);
+
+/// Statistics of the small object pool
+struct SmallObjectPoolStats {
+  size_t allocations;        ///< Number of allocations on this thread
+  size_t system_allocations; ///< Number of times memory was requested from the system, by all threads
+  size_t system_bytes;       ///< Total memory requested from the system, by all threads
+};
+SmallObjectPoolStats small_object_pool_stats();
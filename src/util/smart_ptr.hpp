@@ -34,8 +34,41 @@ using std::make_unique;
 #include <boost/smart_ptr/intrusive_ptr.hpp>
 using boost::intrusive_ptr;
 
+/// Reference count that can be shared between threads
+class AtomicRefCount {
+public:
+  inline void increment() {
+    // a new reference is always made from an existing one, so nothing needs to be ordered
+    count.fetch_add(1, std::memory_order_relaxed);
+  }
+  /// Returns true if this was the last reference
+  inline bool decrement() {
+    // all uses of the object by other threads must happen before it is destroyed
+    return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+private:
+  std::atomic<unsigned int> count = 0;
+};
+
+/// Reference count for objects that are only used by one thread at a time
+/** Handing such an object to another thread needs some other synchronization, such as a mutex or joining a thread.
+ *  This avoids the locked instructions for every copy of a pointer.
+ */
+class LocalRefCount {
+public:
+  inline void increment() {
+    ++count;
+  }
+  inline bool decrement() {
+    return --count == 0;
+  }
+private:
+  unsigned int count = 0;
+};
+
 /// Base class for types that can be pointed to
-template <typename T> class IntrusivePtrBase {
+/** RefCount is AtomicRefCount or LocalRefCount */
+template <typename T, typename RefCount = AtomicRefCount> class IntrusivePtrBase {
 public:
   IntrusivePtrBase() {}
   // don't copy or assign ref count
@@ -46,17 +79,17 @@ protected:
     delete static_cast<const T*>(this);
   }
 private:
-  mutable std::atomic<unsigned int> ref_count = 0;
-  template <typename U> friend void intrusive_ptr_add_ref(const IntrusivePtrBase<U>* ptr);
-  template <typename U> friend void intrusive_ptr_release(const IntrusivePtrBase<U>* ptr);
+  mutable RefCount ref_count;
+  template <typename U, typename R> friend void intrusive_ptr_add_ref(const IntrusivePtrBase<U,R>* ptr);
+  template <typename U, typename R> friend void intrusive_ptr_release(const IntrusivePtrBase<U,R>* ptr);
 };
 
-template <typename T> void intrusive_ptr_add_ref(const IntrusivePtrBase<T>* ptr) {
-  ++(ptr->ref_count);
+template <typename T, typename RefCount> void intrusive_ptr_add_ref(const IntrusivePtrBase<T,RefCount>* ptr) {
+  ptr->ref_count.increment();
 }
 
-template <typename T> void intrusive_ptr_release(const IntrusivePtrBase<T>* ptr) {
-  if (--(ptr->ref_count) == 0) {
+template <typename T, typename RefCount> void intrusive_ptr_release(const IntrusivePtrBase<T,RefCount>* ptr) {
+  if (ptr->ref_count.decrement()) {
     static_cast<const T*>(ptr)->destroy();
   }
 }
@@ -80,8 +113,11 @@ inline intrusive_ptr<T> make_intrusive(Args&&... args) {
 
 template <typename T> using intrusive_ptr = shared_ptr<T>;
 
+class AtomicRefCount;
+class LocalRefCount;
+
 /// Base class for types that can be pointed to
-template <typename T> class IntrusivePtrBase {};
+template <typename T, typename RefCount = AtomicRefCount> class IntrusivePtrBase {};
 
 template <typename T>
 class IntrusiveFromThis : public std::enable_shared_from_this<T> {
@@ -127,7 +163,7 @@ protected:
   virtual void destroy() const {
     delete this;
   }
-  template <typename T> friend void intrusive_ptr_release(const IntrusivePtrBase<T>* ptr);
+  template <typename T, typename RefCount> friend void intrusive_ptr_release(const IntrusivePtrBase<T,RefCount>* ptr);
 };
 
 /// Pointer to 'anything'
@@ -10,12 +10,18 @@
 #include <util/spell_checker.hpp>
 #include <util/string.hpp>
 #include <util/io/package_manager.hpp>
+#include <wx/time.h>
 
 // ----------------------------------------------------------------------------- : Spell checker : construction
 
 map<String,SpellCheckerP> SpellChecker::spellers;
+wxMutex SpellChecker::spellers_mutex;
 
-SpellChecker* SpellChecker::get(const String& language) {
+/// Don't look at the dictionary file more often than this (in milliseconds)
+const int DICTIONARY_CHECK_INTERVAL = 2000;
+
+SpellCheckerP SpellChecker::get(const String& language) {
+  wxMutexLocker lock(spellers_mutex);
   SpellCheckerP& speller = spellers[language];
   if (!speller) {
     String local_dir  = package_manager.getDictionaryDir(true);
@@ -30,17 +36,28 @@ SpellChecker* SpellChecker::get(const String& language) {
       queue_message(MESSAGE_ERROR, _("Dictionary not found for language: ") + language);
     }
   }
-  return speller.get();
+  return speller;
 }
 
-SpellChecker* SpellChecker::get(const String& filename, const String& language) {
+SpellCheckerP SpellChecker::get(const String& filename, const String& language) {
+  wxMutexLocker lock(spellers_mutex);
   SpellCheckerP& speller = spellers[filename + _(".") + language];
+  wxLongLong now = wxGetLocalTimeMillis();
+  if (speller) {
+    // has the dictionary been edited? then the cached verdicts are no longer valid
+    // this is called for every spelling check, so don't look at the file every time
+    if (now - speller->dic_checked < DICTIONARY_CHECK_INTERVAL) return speller;
+    speller->dic_checked = now;
+    time_t modified = wxFileExists(speller->dic_path) ? wxFileModificationTime(speller->dic_path) : 0;
+    if (modified == speller->dic_modified) return speller;
+    speller = SpellCheckerP(); // whoever still uses the old checker keeps it alive
+  }
   if (!speller) {
     String prefix = package_manager.openFilenameFromPackage(nullptr, filename) + _(".");
+    String dic_path = language + _(".dic");
     String local_dir  = package_manager.getDictionaryDir(true);
     String global_dir = package_manager.getDictionaryDir(false);
     String aff_path = language + _(".aff");
-    String dic_path = language + _(".dic");
     if (wxFileExists(prefix + dic_path)) {
       if (wxFileExists(prefix + aff_path)) {
         speller = make_intrusive<SpellChecker>((prefix + aff_path).mb_str(), (prefix + dic_path).mb_str());
@@ -49,12 +66,17 @@ SpellChecker* SpellChecker::get(const String& filename, const String& language)
       } else if (wxFileExists(global_dir + aff_path)) {
         speller = make_intrusive<SpellChecker>((global_dir + aff_path).mb_str(), (prefix + dic_path).mb_str());
       }
+      if (speller) {
+        speller->dic_path     = prefix + dic_path;
+        speller->dic_modified = wxFileModificationTime(speller->dic_path);
+        speller->dic_checked  = now;
+      }
     }
     if (!speller) {
       queue_message(MESSAGE_ERROR, _("Dictionary '") + filename + _("' not found for language: ") + language);
     }
   }
-  return speller.get();
+  return speller;
 }
 
 SpellChecker::SpellChecker(const char* aff_path, const char* dic_path)
@@ -63,6 +85,7 @@ SpellChecker::SpellChecker(const char* aff_path, const char* dic_path)
 {}
 
 void SpellChecker::destroyAll() {
+  wxMutexLocker lock(spellers_mutex);
   spellers.clear();
 }
 
@@ -102,14 +125,34 @@ bool SpellChecker::convert_encoding(const String& word, CharBuffer& out) {
   }
 }
 
-bool SpellChecker::spell(const String& word) {
+/// Maximum number of cached verdicts per checker, when there are more the cache is cleared
+const size_t MAX_CACHED_VERDICTS = 1 << 16;
+
+bool SpellChecker::spellLocked(const String& word) {
   if (word.empty()) return true; // empty word is okay
+  auto it = verdicts.find(word);
+  if (it != verdicts.end()) return it->second;
   CharBuffer str;
-  if (!convert_encoding(word,str)) return false;
-  return Hunspell::spell(str);
+  bool correct = convert_encoding(word,str) && Hunspell::spell(str);
+  if (verdicts.size() >= MAX_CACHED_VERDICTS) verdicts.clear();
+  verdicts.emplace(word, correct);
+  return correct;
+}
+
+bool SpellChecker::spell(const String& word) {
+  wxMutexLocker lock(mutex);
+  return spellLocked(word);
+}
+
+void SpellChecker::spell(const vector<String>& words, vector<bool>& correct) {
+  wxMutexLocker lock(mutex);
+  for (size_t i = 0 ; i < words.size() ; ++i) {
+    if (!correct[i]) correct[i] = spellLocked(words[i]);
+  }
 }
 
 void SpellChecker::suggest(const String& word, vector<String>& suggestions_out) {
+  wxMutexLocker lock(mutex);
   CharBuffer str;
   if (!convert_encoding(word,str)) return;
   // call Hunspell
@@ -23,22 +23,30 @@ DECLARE_POINTER_TYPE(SpellChecker);
 // ----------------------------------------------------------------------------- : Spell checker
 
 /// A spelling checker for a particular language
+/** The verdicts for words are cached, since the same words are checked over and over again
+ *  every time a text is changed or a set is updated.
+ *  Checking is threadsafe.
+ */
 class SpellChecker : public Hunspell, public IntrusivePtrBase<SpellChecker> {
 public:
   SpellChecker(const char* aff_path, const char* dic_path);
   /// Get a SpellChecker object for the given language.
-  /** Returns nullptr on error
-   *  Note: This is not threadsafe yet */
-  static SpellChecker* get(const String& language);
+  /** Returns nullptr on error */
+  static SpellCheckerP get(const String& language);
   /// Get a SpellChecker object for the given language and filename
-  /** Returns nullptr on error
-   *  Note: This is not threadsafe yet */
-  static SpellChecker* get(const String& filename, const String& language);
+  /** Returns nullptr on error.
+   *  If the dictionary file has changed since it was loaded, it is loaded again.
+   *  The file is checked at most once every few seconds.
+   *  The old checker stays alive for as long as someone is still using it. */
+  static SpellCheckerP get(const String& filename, const String& language);
   /// Destroy all cached SpellChecker objects
   static void destroyAll();
 
   /// Check the spelling of a single word
   bool spell(const String& word);
+  /// Check the spelling of a number of words at once
+  /** Sets correct[i] to true for words that are spelled correctly, other values are left alone. */
+  void spell(const vector<String>& words, vector<bool>& correct);
 
   /// Give spelling suggestions
   void suggest(const String& word, vector<String>& suggestions_out);
@@ -48,6 +56,15 @@ private:
   wxCSConv encoding;
   bool convert_encoding(const String& word, CharBuffer& out);
 
-  static map<String,SpellCheckerP> spellers; //< Cached checkers for each language
+  wxMutex mutex;                       ///< Hunspell is not threadsafe, also protects the verdicts
+  unordered_map<String,bool> verdicts; ///< Cached results of spell()
+  String     dic_path;                 ///< Dictionary file, for extra dictionaries
+  time_t     dic_modified = 0;         ///< Modification time of the dictionary file when it was loaded
+  wxLongLong dic_checked  = 0;         ///< When we last looked at the modification time, protected by spellers_mutex
+  /// Check a word, the mutex must be locked
+  bool spellLocked(const String& word);
+
+  static wxMutex spellers_mutex;             ///< Protects spellers
+  static map<String,SpellCheckerP> spellers; ///< Cached checkers for each language
 };
 
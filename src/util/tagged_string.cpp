@@ -325,6 +325,62 @@ String anti_tag(const String& tag) {
 
 // ----------------------------------------------------------------------------- : Cursor position
 
+/// The cursor position for an index strictly inside the atom or sep tag that starts at i and whose close tag is at close
+/** cursor is the cursor position before the atom */
+static size_t atom_index_to_cursor(const String& str, size_t i, size_t close, size_t index, size_t cursor, Movement dir) {
+  // Index is inside an atom, determine on which side we want the cursor
+  // This is the only place where MOVE_LEFT/RIGHT and MOVE_*_OPT differ
+  // for the OPT version we must check if we are actually past any real characters
+  // but, if the atom is empty, it still counts as a single character!
+  if (dir == MOVE_LEFT) {
+    return cursor;
+  } else if (dir == MOVE_RIGHT) {
+    return cursor + 1;
+  } else if (dir == MOVE_LEFT_OPT) {
+    // is there any non-tag after index?
+    bool empty = true;
+    while (i < close) {
+      Char c = str.GetChar(i);
+      if (c == _('<')) {
+        i = skip_tag(str, i);
+      } else if (i >= index) {
+        return cursor; // this is a non-tag character after index
+      } else {
+        empty = false;
+        ++i;
+      }
+    }
+    return empty ? cursor : cursor + 1; // still didn't pass any
+  } else if (dir == MOVE_RIGHT_OPT) {
+    // is index actually past any non-tag?
+    while (i < close) {
+      if (i >= index) {
+        return cursor; // we didn't pass any non-tag stuff
+      }
+      Char c = str.GetChar(i);
+      if (c != _('<')) break;
+      i = skip_tag(str, i);
+    }
+    return cursor + 1; // yes it is
+  } else {
+    // count number of actual characters before/after
+    int before_c = 0;
+    int after_c  = 0;
+    while (i < close) {
+      Char c = str.GetChar(i);
+      if (c == _('<')) {
+        i = skip_tag(str, i);
+      } else {
+        if (i < index) before_c++;
+        else           after_c++;
+        ++i;
+      }
+    }
+    // take the closest side
+    return before_c <= after_c ? cursor : cursor + 1;
+  }
+}
+
 size_t index_to_cursor(const String& str, size_t index, Movement dir) {
   size_t cursor = 0;
   index = min(index, str.size());
@@ -341,57 +397,7 @@ size_t index_to_cursor(const String& str, size_t index, Movement dir) {
         size_t close = match_close_tag(str, i);
         size_t after = skip_tag(str, close);
         if (index > before && index < after) {
-          // Index is inside an atom, determine on which side we want the cursor
-          // This is the only place where MOVE_LEFT/RIGHT and MOVE_*_OPT differ
-          // for the OPT version we must check if we are actually past any real characters
-          // but, if the atom is empty, it still counts as a single character!
-          if (dir == MOVE_LEFT) {
-            return cursor;
-          } else if (dir == MOVE_RIGHT) {
-            return cursor + 1;
-          } else if (dir == MOVE_LEFT_OPT) {
-            // is there any non-tag after index?
-            bool empty = true;
-            while (i < close) {
-              c = str.GetChar(i);
-              if (c == _('<')) {
-                i = skip_tag(str, i);
-              } else if (i >= index) {
-                return cursor; // this is a non-tag character after index
-              } else {
-                empty = false;
-                ++i;
-              }
-            }
-            return empty ? cursor : cursor + 1; // still didn't pass any
-          } else if (dir == MOVE_RIGHT_OPT) {
-            // is index actually past any non-tag?
-            while (i < close) {
-              if (i >= index) {
-                return cursor; // we didn't pass any non-tag stuff
-              }
-              c = str.GetChar(i);
-              if (c != _('<')) break;
-              i = skip_tag(str, i);
-            }
-            return cursor + 1; // yes it is
-          } else if (dir == MOVE_MID) {
-            // count number of actual characters before/after
-            int before_c = 0;
-            int after_c  = 0;
-            while (i < close) {
-              c = str.GetChar(i);
-              if (c == _('<')) {
-                i = skip_tag(str, i);
-              } else {
-                if (i < index) before_c++;
-                else           after_c++;
-                ++i;
-              }
-            }
-            // take the closest side
-            return before_c <= after_c ? cursor : cursor + 1;
-          }
+          return atom_index_to_cursor(str, i, close, index, cursor, dir);
         }
         i = after;
       } else if (i == 0 && is_substr(str, i, _("<prefix"))) {
@@ -459,9 +465,8 @@ void cursor_to_index_range(const String& str, size_t cursor, size_t& start, size
   end = max(end, start + 1); // always start < end, since there are always valid cursor positions
 }
 
-size_t cursor_to_index(const String& str, size_t cursor, Movement dir) {
-  size_t start, end;
-  cursor_to_index_range(str, cursor, start, end);
+/// Pick an index in the range [start...end) of indices for a single cursor position
+static size_t index_in_cursor_range(const String& str, size_t start, size_t end, Movement dir) {
   assert(end <= str.size()+1);
   if (dir == MOVE_MID) {
     // find the middle between start and end
@@ -490,6 +495,12 @@ size_t cursor_to_index(const String& str, size_t cursor, Movement dir) {
   return dir <= 0 /*MOVE_LEFT*/ ? start : end - 1;
 }
 
+size_t cursor_to_index(const String& str, size_t cursor, Movement dir) {
+  size_t start, end;
+  cursor_to_index_range(str, cursor, start, end);
+  return index_in_cursor_range(str, start, end, dir);
+}
+
 String untag_for_cursor(const String& str) {
   String ret; ret.reserve(str.size());
   for (size_t i = 0 ; i < str.size() ; ) {
@@ -555,6 +566,119 @@ size_t index_to_untagged(const String& str, size_t index) {
   return p;
 }
 
+// ----------------------------------------------------------------------------- : Position map
+
+// Note: the loops here mirror those of the functions above, so the results are the same even for invalid strings
+
+TaggedPositions::TaggedPositions(const String& str)
+  : str(str), end_index(str.size()), has_prefix(false)
+{
+  // cursor steps, as in index_to_cursor
+  size_t cursor = 0;
+  for (size_t i = 0 ; i < str.size() ;) {
+    Step step = {i, i, cursor, String::npos, true, false};
+    if (str.GetChar(i) == _('<')) {
+      if (is_substr(str, i, _("<atom")) || is_substr(str, i, _("<sep"))) {
+        step.is_atom = true;
+        step.close = match_close_tag(str, i);
+        i = skip_tag(str, step.close);
+      } else if (i == 0 && is_substr(str, i, _("<prefix"))) {
+        has_prefix = true;
+        i = match_close_tag_end(str, i);
+        step.has_width = false;
+      } else if (is_substr(str, i, _("<suffix")) && match_close_tag_end(str,i) >= str.size()) {
+        end_index = i;
+        break;
+      } else {
+        i = skip_tag(str, i);
+        step.has_width = false;
+      }
+    } else {
+      i++;
+    }
+    step.end = i;
+    steps.push_back(step);
+    if (step.has_width) cursor++;
+  }
+  end_cursor = cursor;
+  // untagged positions, as in untagged_to_index
+  size_t i = 0;
+  while (i < str.size()) {
+    if (str.GetChar(i) == _('<')) {
+      tags.push_back(i);
+      i = skip_tag(str, i);
+    } else {
+      chars.push_back(i);
+      i++;
+    }
+  }
+  untagged_end = i;
+}
+
+size_t TaggedPositions::indexToCursor(size_t index, Movement dir) const {
+  index = min(index, str.size());
+  // the first step that ends after index
+  auto it = upper_bound(steps.begin(), steps.end(), index, [](size_t index, const Step& step) { return index < step.end; });
+  if (it == steps.end()) return end_cursor;
+  if (it->is_atom && index > it->start) {
+    return atom_index_to_cursor(str, it->start, it->close, index, it->cursor, dir);
+  }
+  return it->cursor;
+}
+
+void TaggedPositions::cursorToIndexRange(size_t cursor, size_t& start, size_t& end) const {
+  if (cursor > end_cursor) {
+    start = end = end_index;
+    end = max(end, start + 1);
+    return;
+  }
+  // the first step with this cursor position
+  auto it = lower_bound(steps.begin(), steps.end(), cursor, [](const Step& step, size_t cursor) { return step.cursor < cursor; });
+  // start is after the step that moved the cursor to this position
+  if (cursor == 0) {
+    start = has_prefix ? steps.front().end : 0;
+  } else {
+    auto before = lower_bound(steps.begin(), it, cursor - 1, [](const Step& step, size_t cursor) { return step.cursor < cursor; });
+    while (!before->has_width) ++before;
+    start = before->end;
+  }
+  // end is after the tags at this position, but before an atom or the next character
+  size_t i = it == steps.begin() ? 0 : (it - 1)->end;
+  for ( ; it != steps.end() && it->cursor == cursor ; ++it) {
+    if (it->is_atom) {
+      i = it->start + 1;
+      break;
+    }
+    i = it->end;
+    if (it->has_width) break;
+  }
+  end = min(i, str.size());
+  end = max(end, start + 1);
+}
+
+size_t TaggedPositions::cursorToIndex(size_t cursor, Movement dir) const {
+  size_t start, end;
+  cursorToIndexRange(cursor, start, end);
+  return index_in_cursor_range(str, start, end, dir);
+}
+
+size_t TaggedPositions::untaggedToIndex(size_t pos, bool inside) const {
+  if (pos > chars.size()) return untagged_end;
+  // the tags between the previous character and this one
+  size_t gap_start = pos == 0 ? 0 : chars[pos - 1] + 1;
+  size_t gap_end   = pos < chars.size() ? chars[pos] : untagged_end;
+  for (auto it = lower_bound(tags.begin(), tags.end(), gap_start) ; it != tags.end() && *it < gap_end ; ++it) {
+    bool is_close = is_substr(str, *it, _("</"));
+    if (is_close == inside) return *it;
+  }
+  return gap_end;
+}
+
+size_t TaggedPositions::indexToUntagged(size_t index) const {
+  index = min(str.size(), index);
+  return lower_bound(chars.begin(), chars.end(), index) - chars.begin();
+}
+
 // ----------------------------------------------------------------------------- : Global operations
 
 String remove_tag(const String& str, const String& tag) {
@@ -619,10 +743,23 @@ String get_tags(const String& str, size_t start, size_t end, bool open_tags, boo
   return ret;
 }
 
+/// Is replacing [start...end) of str with replacement a plain text edit that is not next to a tag?
+static bool is_untagged_edit(const String& str, size_t start, size_t end, const String& replacement) {
+  if (start > 0 && str.GetChar(start - 1) == _('>')) return false;
+  if (end < str.size() && str.GetChar(end) == _('<')) return false;
+  if (replacement.find(_('<')) != String::npos) return false;
+  for (size_t i = start ; i < end ; ++i) {
+    if (str.GetChar(i) == _('<')) return false;
+  }
+  return true;
+}
+
 String tagged_substr_replace(const String& input, size_t start, size_t end, const String& replacement) {
   assert(start <= end);
-  size_t size = input.size();
-  String ret; ret.reserve(size + replacement.size() - (end - start)); // estimated size
+  if (is_untagged_edit(input, start, end, replacement)) {
+    // no tags to fix or to cancel out
+    return substr_replace(input, start, end, replacement);
+  }
   String collect_tags = simplify_tagged_merge(get_tags(input, start, end, true, true),true);
   return simplify_tagged(
     substr_replace(input, start, end,
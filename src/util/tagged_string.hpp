@@ -178,6 +178,44 @@ size_t untagged_to_index(const String& str, size_t pos, bool inside, size_t star
  */
 size_t index_to_untagged(const String& str, size_t index);
 
+// ----------------------------------------------------------------------------- : Position map
+
+/// Precomputed positions in a tagged string, for converting between indices, cursor positions and untagged positions
+/** Gives the same results as index_to_cursor, cursor_to_index, untagged_to_index and index_to_untagged,
+ *  but instead of scanning the string from the start, every conversion is a binary search
+ *  (plus a scan over the tags at a single position).
+ *  The map refers to the string, so the string must outlive the map.
+ *  The map is immutable, build a new one when the string changes.
+ */
+class TaggedPositions {
+public:
+  TaggedPositions(const String& str);
+  
+  size_t indexToCursor(size_t index, Movement dir = MOVE_MID) const;
+  void   cursorToIndexRange(size_t cursor, size_t& start, size_t& end) const;
+  size_t cursorToIndex(size_t cursor, Movement dir = MOVE_MID) const;
+  size_t untaggedToIndex(size_t pos, bool inside) const;
+  size_t indexToUntagged(size_t index) const;
+  
+private:
+  /// A range of indices that is a single step for the cursor: a character, a tag or an atom
+  struct Step {
+    size_t start, end;  ///< The indices [start...end)
+    size_t cursor;      ///< Cursor position before this step
+    size_t close;       ///< For atoms: the position of the close tag
+    bool   has_width;   ///< Does this step move the cursor?
+    bool   is_atom;     ///< Is this an <atom> or <sep> tag, which counts as a single character?
+  };
+  const String& str;       ///< The string this map is for, not copied
+  vector<Step> steps;      ///< All steps, in order, until the end of the string or a <suffix>
+  size_t       end_cursor; ///< Cursor position at the end
+  size_t       end_index;  ///< Index of the end, this is the start of a <suffix> if there is one
+  bool         has_prefix; ///< Does the string start with a <prefix>?
+  vector<size_t> chars;    ///< Indices of the characters outside tags, the untagged positions
+  vector<size_t> tags;     ///< Indices of the tags, not counting those inside other tags
+  size_t       untagged_end; ///< Index where scanning for untagged positions stops
+};
+
 // ----------------------------------------------------------------------------- : Global operations
 
 /// Remove all instances of a tag and its close tag, but keep the contents.
@@ -210,6 +248,9 @@ String get_tags(const String& str, size_t start, size_t end, bool open_tags, boo
  *  This means that when removing "<x>a</x>" nothing is left,
  *  but with input "<x>a" -> "<x>" and "</>a" -> "</>".
  *  Does not escape the replacement.
+ *
+ *  Plain text edits away from any tags (the common case when typing) can't change the tags,
+ *  then the rest of the string is not touched, and the cost doesn't depend on the number of tags.
  */
 String tagged_substr_replace(const String& input, size_t start, size_t end, const String& replacement);
 
@@ -302,5 +302,8 @@ enum ControlID {
   ID_ADD_ITEM,
   ID_REMOVE_ITEM,
   ID_DEFAULTS,
+  // Profiler window
+  ID_PROFILER_ENABLE,
+  ID_PROFILER_TRACE,
 };
 
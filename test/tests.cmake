@@ -15,6 +15,31 @@ add_test(
   NAME script-functions
   COMMAND magicseteditor ${test_dir}/script/script-functions.mse-script
 )
+# The same scripts must give the same results with and without the optimizer
+add_test(
+  NAME script-functions-unoptimized
+  COMMAND magicseteditor ${test_dir}/script/script-functions.mse-script --no-script-optimization
+)
+add_test(
+  NAME script-optimizer
+  COMMAND magicseteditor ${test_dir}/script/script-optimizer.mse-script
+)
+add_test(
+  NAME script-optimizer-unoptimized
+  COMMAND magicseteditor ${test_dir}/script/script-optimizer.mse-script --no-script-optimization
+)
+add_test(
+  NAME script-memo
+  COMMAND magicseteditor ${test_dir}/script/script-memo.mse-script
+)
 
 # Rendering tests
-# TODO
+# Renders a small generated set and compares the first cards against test/benchmark/golden
+# Golden images are created with "magicseteditor --benchmark --data test/benchmark/data --cards 20 --update-golden",
+# once they are committed add --require-golden, so that missing images fail the test
+# For timings use a larger set, e.g. "magicseteditor --benchmark --data test/benchmark/data --cards 1000"
+# Symbol import (tracing a generated image) is timed as well, use --import-size 2000 for large images
+add_test(
+  NAME rendering
+  COMMAND magicseteditor --benchmark --data ${test_dir}/benchmark/data --cards 20 --iterations 2
+)